@@ -1,5 +1,7 @@
 #include "bus/bus.h"
 
+#include "util/selfprof.h"
+
 bool Bus::AddPeripheral(std::uint32_t base_addr,
                         const PeripheralPtr &peripheral) {
   // get address space length of peripheral
@@ -30,6 +32,7 @@ PeripheralInterface *Bus::GetPeripheral(std::uint32_t addr) {
 
 PeripheralInterface *Bus::GetPeripheral(std::uint32_t addr,
                                         std::uint32_t &offset) {
+  SELF_PROFILE_SCOPE(BusDecode);
   // TODO: optimize time complexity (<= O(logn))
   for (const auto &i : peripherals_) {
     if (addr >= i.base_addr && addr < i.base_addr + i.size) {
@@ -43,35 +46,41 @@ PeripheralInterface *Bus::GetPeripheral(std::uint32_t addr,
 std::uint8_t Bus::ReadByte(std::uint32_t addr) {
   std::uint32_t offset;
   auto io = GetPeripheral(addr, offset);
+  SELF_PROFILE_SCOPE(Device);
   return io ? io->ReadByte(offset) : 0;
 }
 
 void Bus::WriteByte(std::uint32_t addr, std::uint8_t value) {
   std::uint32_t offset;
   auto io = GetPeripheral(addr, offset);
+  SELF_PROFILE_SCOPE(Device);
   if (io) io->WriteByte(offset, value);
 }
 
 std::uint16_t Bus::ReadHalf(std::uint32_t addr) {
   std::uint32_t offset;
   auto io = GetPeripheral(addr, offset);
+  SELF_PROFILE_SCOPE(Device);
   return io ? io->ReadHalf(offset) : 0;
 }
 
 void Bus::WriteHalf(std::uint32_t addr, std::uint16_t value) {
   std::uint32_t offset;
   auto io = GetPeripheral(addr, offset);
+  SELF_PROFILE_SCOPE(Device);
   if (io) io->WriteHalf(offset, value);
 }
 
 std::uint32_t Bus::ReadWord(std::uint32_t addr) {
   std::uint32_t offset;
   auto io = GetPeripheral(addr, offset);
+  SELF_PROFILE_SCOPE(Device);
   return io ? io->ReadWord(offset) : 0;
 }
 
 void Bus::WriteWord(std::uint32_t addr, std::uint32_t value) {
   std::uint32_t offset;
   auto io = GetPeripheral(addr, offset);
+  SELF_PROFILE_SCOPE(Device);
   if (io) io->WriteWord(offset, value);
 }
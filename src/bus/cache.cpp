@@ -0,0 +1,287 @@
+#include "bus/cache.h"
+
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+#include <string>
+#include <cassert>
+
+namespace {
+
+// max count of PCs in report
+constexpr std::size_t kMaxReportPCs = 20;
+
+// default configuration
+constexpr std::string_view kDefaultSpec =
+    "l1i:16k:4:64:lru,l1d:16k:4:64:lru:wb,l2:128k:8:64:lru:wb";
+
+// check if value is power of 2
+inline bool IsPowerOf2(std::uint32_t value) {
+  return value && !(value & (value - 1));
+}
+
+// get log2 of value (must be power of 2)
+inline std::uint32_t Log2(std::uint32_t value) {
+  std::uint32_t bits = 0;
+  while (value >>= 1) ++bits;
+  return bits;
+}
+
+// split the first field (separated by 'sep') from string
+std::string_view SplitField(std::string_view &s, char sep) {
+  auto pos = s.find(sep);
+  auto field = s.substr(0, pos);
+  s = pos == std::string_view::npos ? std::string_view()
+                                    : s.substr(pos + 1);
+  return field;
+}
+
+// parse size with optional 'k'/'m' suffix, returns false if failed
+bool ParseSize(std::string_view s, std::uint32_t &size) {
+  std::uint32_t unit = 1;
+  if (!s.empty() && (s.back() == 'k' || s.back() == 'K')) {
+    unit = 1024;
+    s.remove_suffix(1);
+  }
+  else if (!s.empty() && (s.back() == 'm' || s.back() == 'M')) {
+    unit = 1024 * 1024;
+    s.remove_suffix(1);
+  }
+  if (s.empty() || s.size() > 9) return false;
+  std::uint32_t value = 0;
+  for (const auto &c : s) {
+    if (c < '0' || c > '9') return false;
+    value = value * 10 + (c - '0');
+  }
+  size = value * unit;
+  return size / unit == value;
+}
+
+// print statistics of a cache level
+void PrintLevel(std::ostream &os, std::string_view name,
+                const CacheLevel &level) {
+  const auto &config = level.config();
+  const auto &stats = level.stats();
+  auto accesses = stats.reads + stats.writes;
+  auto misses = stats.read_misses + stats.write_misses;
+  os << name << ": " << config.size / 1024 << "KiB, " << config.ways
+     << "-way, " << config.line_size << "B line, ";
+  switch (config.replace) {
+    case CacheReplace::LRU: os << "LRU"; break;
+    case CacheReplace::FIFO: os << "FIFO"; break;
+    case CacheReplace::Random: os << "random"; break;
+  }
+  // write policy of instruction cache is meaningless
+  if (name != "L1I") {
+    os << ", " << (config.write_back ? "write-back" : "write-through");
+  }
+  os << std::endl;
+  os << "  accesses:    " << accesses << " (" << stats.reads
+     << " reads, " << stats.writes << " writes)" << std::endl;
+  os << "  misses:      " << misses << " (" << stats.read_misses
+     << " reads, " << stats.write_misses << " writes)" << std::endl;
+  os << "  miss rate:   " << std::fixed << std::setprecision(2)
+     << (accesses ? misses * 100.0 / accesses : 0.0) << "%" << std::endl;
+  os << "  evictions:   " << stats.evictions << std::endl;
+  os << "  write-backs: " << stats.write_backs << std::endl;
+}
+
+}  // namespace
+
+CacheLevel::CacheLevel(const CacheConfig &config)
+    : config_(config), time_(0), seed_(0x2545f491),
+      last_line_(kInvalidTag), last_way_(0), stats_({}) {
+  assert(IsPowerOf2(config.size) && IsPowerOf2(config.ways) &&
+         IsPowerOf2(config.line_size));
+  assert(config.size >= config.ways * config.line_size);
+  line_bits_ = Log2(config.line_size);
+  set_mask_ = config.size / config.ways / config.line_size - 1;
+  auto lines = config.size / config.line_size;
+  tags_.resize(lines, kInvalidTag);
+  stamps_.resize(lines, 0);
+  dirty_.resize(lines, 0);
+}
+
+bool CacheLevel::Access(std::uint32_t addr, bool is_store,
+                        std::uint32_t &victim) {
+  is_store ? ++stats_.writes : ++stats_.reads;
+  ++time_;
+  auto line = addr >> line_bits_;
+  // fast path, access to the last accessed line
+  if (line == last_line_) {
+    if (config_.replace == CacheReplace::LRU) stamps_[last_way_] = time_;
+    if (is_store && config_.write_back) dirty_[last_way_] = 1;
+    return true;
+  }
+  // scan all ways in set
+  std::size_t base = (line & set_mask_) * config_.ways;
+  for (auto way = base; way < base + config_.ways; ++way) {
+    if (tags_[way] == line) {
+      if (config_.replace == CacheReplace::LRU) stamps_[way] = time_;
+      if (is_store && config_.write_back) dirty_[way] = 1;
+      last_line_ = line;
+      last_way_ = way;
+      return true;
+    }
+  }
+  // miss
+  is_store ? ++stats_.write_misses : ++stats_.read_misses;
+  // no-write-allocate
+  if (is_store && !config_.write_back) return false;
+  // replace a line
+  auto way = SelectVictim(base);
+  if (tags_[way] != kInvalidTag) {
+    ++stats_.evictions;
+    if (dirty_[way]) {
+      ++stats_.write_backs;
+      victim = tags_[way] << line_bits_;
+    }
+  }
+  tags_[way] = line;
+  stamps_[way] = time_;
+  dirty_[way] = is_store;
+  last_line_ = line;
+  last_way_ = way;
+  return false;
+}
+
+std::size_t CacheLevel::SelectVictim(std::size_t base) {
+  // use invalid way first
+  for (auto way = base; way < base + config_.ways; ++way) {
+    if (tags_[way] == kInvalidTag) return way;
+  }
+  if (config_.replace == CacheReplace::Random) {
+    // xorshift32
+    seed_ ^= seed_ << 13;
+    seed_ ^= seed_ >> 17;
+    seed_ ^= seed_ << 5;
+    return base + (seed_ & (config_.ways - 1));
+  }
+  // LRU & FIFO, select the way with the oldest stamp
+  auto victim = base;
+  for (auto way = base + 1; way < base + config_.ways; ++way) {
+    if (stamps_[way] < stamps_[victim]) victim = way;
+  }
+  return victim;
+}
+
+bool CacheModel::Configure(std::string_view spec) {
+  if (spec == "default") spec = kDefaultSpec;
+  while (!spec.empty()) {
+    auto level_spec = SplitField(spec, ',');
+    // get level
+    auto name = SplitField(level_spec, ':');
+    std::optional<CacheLevel> *level;
+    if (name == "l1i") {
+      level = &l1i_;
+    }
+    else if (name == "l1d") {
+      level = &l1d_;
+    }
+    else if (name == "l2") {
+      level = &l2_;
+    }
+    else {
+      return false;
+    }
+    // get geometry
+    CacheConfig config = {0, 0, 0, CacheReplace::LRU, false};
+    if (!ParseSize(SplitField(level_spec, ':'), config.size) ||
+        !ParseSize(SplitField(level_spec, ':'), config.ways) ||
+        !ParseSize(SplitField(level_spec, ':'), config.line_size)) {
+      return false;
+    }
+    if (!IsPowerOf2(config.size) || !IsPowerOf2(config.ways) ||
+        !IsPowerOf2(config.line_size) || config.line_size < 4 ||
+        config.size < config.ways * config.line_size) {
+      return false;
+    }
+    // get policies
+    while (!level_spec.empty()) {
+      auto policy = SplitField(level_spec, ':');
+      if (policy == "lru") {
+        config.replace = CacheReplace::LRU;
+      }
+      else if (policy == "fifo") {
+        config.replace = CacheReplace::FIFO;
+      }
+      else if (policy == "random") {
+        config.replace = CacheReplace::Random;
+      }
+      else if (policy == "wb") {
+        config.write_back = true;
+      }
+      else if (policy == "wt") {
+        config.write_back = false;
+      }
+      else {
+        return false;
+      }
+    }
+    level->emplace(config);
+  }
+  return true;
+}
+
+void CacheModel::AccessL2(std::uint32_t addr, bool is_store) {
+  if (!l2_) {
+    is_store ? ++mem_writes_ : ++mem_reads_;
+    return;
+  }
+  auto victim = kNoVictim;
+  auto hit = l2_->Access(addr, is_store, victim);
+  if (victim != kNoVictim) ++mem_writes_;
+  if (is_store && !l2_->config().write_back) {
+    ++mem_writes_;
+  }
+  else if (!hit) {
+    ++mem_reads_;
+  }
+  if (!hit) Miss(kMissL2);
+}
+
+bool CacheModel::WriteReport(std::string_view file,
+                             const SymbolTable &symbols) const {
+  std::ofstream ofs{std::string(file)};
+  if (!ofs) return false;
+  // print statistics of all levels
+  ofs << "Cache statistics:" << std::endl;
+  ofs << std::endl;
+  if (l1i_) PrintLevel(ofs, "L1I", *l1i_);
+  if (l1d_) PrintLevel(ofs, "L1D", *l1d_);
+  if (l2_) PrintLevel(ofs, "L2", *l2_);
+  ofs << "Memory: " << mem_reads_ << " line reads, " << mem_writes_
+      << " line writes" << std::endl;
+  ofs << "TLB: " << kTLBSize << " entries, " << tlb_lookups_
+      << " lookups, " << tlb_misses_ << " misses (page table walks)"
+      << std::endl;
+  // sort PCs by total misses, and then by address
+  std::vector<std::pair<std::uint32_t, std::uint64_t>> pcs;
+  for (const auto &[pc, misses] : pc_misses_) {
+    std::uint64_t total = 0;
+    for (const auto &count : misses) total += count;
+    pcs.push_back({pc, total});
+  }
+  std::sort(pcs.begin(), pcs.end(), [](const auto &lhs, const auto &rhs) {
+    return lhs.second != rhs.second ? lhs.second > rhs.second
+                                    : lhs.first < rhs.first;
+  });
+  if (pcs.size() > kMaxReportPCs) pcs.resize(kMaxReportPCs);
+  // print top missing PCs
+  ofs << std::endl;
+  ofs << "Top missing PCs:" << std::endl;
+  ofs << std::endl;
+  ofs << "       L1I miss      L1D miss       L2 miss   address  symbol"
+      << std::endl;
+  for (const auto &[pc, total] : pcs) {
+    const auto &misses = pc_misses_.at(pc);
+    for (const auto &count : misses) {
+      ofs << std::setw(14) << std::setfill(' ') << std::dec << count;
+    }
+    ofs << "  " << std::setw(8) << std::setfill('0') << std::hex << pc;
+    auto name = symbols.Symbolize(pc);
+    if (!name.empty()) ofs << "  " << name;
+    ofs << std::endl;
+  }
+  return static_cast<bool>(ofs);
+}
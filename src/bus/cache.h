@@ -0,0 +1,187 @@
+#ifndef RISKY32_BUS_CACHE_H_
+#define RISKY32_BUS_CACHE_H_
+
+#include <string_view>
+#include <vector>
+#include <array>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+
+#include "util/symtab.h"
+
+// replacement policy of cache
+enum class CacheReplace : std::uint8_t { LRU, FIFO, Random };
+
+// configuration of a cache level
+struct CacheConfig {
+  // total size, associativity & line size (all must be power of 2)
+  std::uint32_t size, ways, line_size;
+  // replacement policy
+  CacheReplace replace;
+  // write-back & write-allocate if true,
+  // otherwise write-through & no-write-allocate
+  bool write_back;
+};
+
+// statistics of a cache level
+struct CacheStats {
+  std::uint64_t reads, writes;
+  std::uint64_t read_misses, write_misses;
+  std::uint64_t evictions, write_backs;
+};
+
+// a level of set-associative cache (only tags are modelled)
+// tags, stamps and dirty flags are kept in separate arrays (SoA),
+// so that a lookup only scans a few adjacent tags
+class CacheLevel {
+ public:
+  CacheLevel(const CacheConfig &config);
+
+  // access a line, returns true if hit
+  // address of evicted dirty line (if any) is stored to 'victim'
+  bool Access(std::uint32_t addr, bool is_store, std::uint32_t &victim);
+
+  // getters
+  // configuration
+  const CacheConfig &config() const { return config_; }
+  // statistics
+  const CacheStats &stats() const { return stats_; }
+  // bit width of offset in line
+  std::uint32_t line_bits() const { return line_bits_; }
+
+ private:
+  // tag of invalid line
+  static constexpr std::uint32_t kInvalidTag = 0xffffffff;
+
+  // select a way to be replaced in set
+  std::size_t SelectVictim(std::size_t base);
+
+  CacheConfig config_;
+  std::uint32_t line_bits_, set_mask_;
+  // line address of each way
+  std::vector<std::uint32_t> tags_;
+  // LRU: last access time, FIFO: fill time
+  std::vector<std::uint64_t> stamps_;
+  // dirty flag of each way
+  std::vector<std::uint8_t> dirty_;
+  // current time & random seed
+  std::uint64_t time_;
+  std::uint32_t seed_;
+  // last accessed line & way (fast path of sequential accesses)
+  std::uint32_t last_line_;
+  std::size_t last_way_;
+  CacheStats stats_;
+};
+
+// cache hierarchy (L1I/L1D and unified L2, all optional), statistics
+// only, data are still read from & written to bus directly
+// a TLB is also modelled, so that page table walks only access caches
+// when missed in TLB (MMU itself has no TLB)
+class CacheModel {
+ public:
+  CacheModel()
+      : tlb_({}), tlb_lookups_(0), tlb_misses_(0), pc_(nullptr),
+        mem_reads_(0), mem_writes_(0) {}
+
+  // parse & apply configuration, returns false if failed
+  // format: 'LEVEL:SIZE:WAYS:LINE[:lru|fifo|random][:wb|wt],...',
+  // 'LEVEL' can be 'l1i', 'l1d' or 'l2', or 'default' for the
+  // default configuration
+  bool Configure(std::string_view spec);
+  // mark an address range as uncacheable (e.g. MMIO devices)
+  void AddUncached(std::uint32_t addr, std::uint32_t size) {
+    uncached_.push_back({addr, size});
+  }
+
+  // model an instruction fetch
+  void Fetch(std::uint32_t addr) {
+    if (IsUncached(addr)) return;
+    if (!l1i_) {
+      AccessL2(addr, false);
+      return;
+    }
+    auto victim = kNoVictim;
+    if (l1i_->Access(addr, false, victim)) return;
+    Miss(kMissL1I);
+    AccessL2(addr, false);
+  }
+  // model a translation of virtual page 'vpn' in address space 'satp',
+  // returns false if missed in TLB (page table walk is needed)
+  bool Translate(std::uint32_t satp, std::uint32_t vpn) {
+    // 'satp' is never zero if translation is enabled, so zero tag is
+    // an invalid entry
+    auto tag = (static_cast<std::uint64_t>(satp) << 20) | vpn;
+    auto &entry = tlb_[vpn & (kTLBSize - 1)];
+    ++tlb_lookups_;
+    if (entry == tag) return true;
+    entry = tag;
+    ++tlb_misses_;
+    return false;
+  }
+  // model a data load/store
+  void Access(std::uint32_t addr, bool is_store) {
+    if (IsUncached(addr)) return;
+    if (!l1d_) {
+      AccessL2(addr, is_store);
+      return;
+    }
+    auto victim = kNoVictim;
+    auto hit = l1d_->Access(addr, is_store, victim);
+    if (victim != kNoVictim) AccessL2(victim, true);
+    // write-through cache forwards all stores to the next level,
+    // otherwise lines are filled by reads
+    auto forward = is_store && !l1d_->config().write_back;
+    if (!hit) Miss(kMissL1D);
+    if (forward || !hit) AccessL2(addr, forward);
+  }
+
+  // write statistics & top missing PCs, returns false if failed
+  bool WriteReport(std::string_view file, const SymbolTable &symbols) const;
+
+  // setters
+  // PC of current instruction (for miss attribution)
+  void set_pc(const std::uint32_t *pc) { pc_ = pc; }
+
+ private:
+  // no victim line
+  static constexpr std::uint32_t kNoVictim = 0xffffffff;
+  // entry count of TLB (direct-mapped, 'sfence.vma' is not modelled)
+  static constexpr std::size_t kTLBSize = 64;
+  // index of miss counters
+  enum MissKind { kMissL1I, kMissL1D, kMissL2, kMissKindCount };
+
+  // check if address is uncacheable
+  bool IsUncached(std::uint32_t addr) const {
+    for (const auto &range : uncached_) {
+      if (addr - range.first < range.second) return true;
+    }
+    return false;
+  }
+  // access L2 (or memory if there is no L2)
+  void AccessL2(std::uint32_t addr, bool is_store);
+  // count a miss of current PC
+  void Miss(MissKind kind) {
+    if (pc_) ++pc_misses_[*pc_][kind];
+  }
+
+  // cache levels
+  std::optional<CacheLevel> l1i_, l1d_, l2_;
+  // tags of TLB entries & statistics
+  std::array<std::uint64_t, kTLBSize> tlb_;
+  std::uint64_t tlb_lookups_, tlb_misses_;
+  // uncacheable address ranges (address, size)
+  std::vector<std::pair<std::uint32_t, std::uint32_t>> uncached_;
+  // pointer to current PC
+  const std::uint32_t *pc_;
+  // miss counts of each PC
+  std::unordered_map<std::uint32_t,
+                     std::array<std::uint64_t, kMissKindCount>>
+      pc_misses_;
+  // count of line reads & writes of memory
+  std::uint64_t mem_reads_, mem_writes_;
+};
+
+#endif  // RISKY32_BUS_CACHE_H_
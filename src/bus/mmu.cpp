@@ -2,6 +2,7 @@
 
 #include "define/csr.h"
 #include "util/cast.h"
+#include "util/selfprof.h"
 
 /*
 
@@ -97,6 +98,7 @@ Unrolled version (unrolled by MaxXing):
 
 std::uint32_t MMU::GetPhysicalAddr(std::uint32_t addr, bool is_store,
                                    bool is_execute) {
+  SELF_PROFILE_SCOPE(Translate);
   last_vaddr_ = addr;
   auto satp_val = csr_.satp();
   auto satp = PtrCast<SATP>(&satp_val);
@@ -105,9 +107,13 @@ std::uint32_t MMU::GetPhysicalAddr(std::uint32_t addr, bool is_store,
     return addr;
   }
   else {
+    ++page_walk_count_;
+    // page table walk accesses caches only if missed in TLB model
+    auto model_walk = cache_ && !cache_->Translate(satp_val, addr >> 12);
     auto va = PtrCast<Sv32VAddr>(&addr);
     // read first page table entry from bus
     auto pte_addr = (satp->ppn << 12) + (va->vpn1) * 4;
+    if (model_walk) AccessCache(pte_addr, false);
     auto pte_val = bus_->ReadWord(pte_addr);
     auto pte = PtrCast<Sv32PTE>(&pte_val);
     // check if is valid PTE
@@ -117,6 +123,7 @@ std::uint32_t MMU::GetPhysicalAddr(std::uint32_t addr, bool is_store,
       // read second page table entry from bus
       auto pte_ppn = (pte->ppn1 << 10) | pte->ppn0;
       pte_addr = (pte_ppn << 12) + (va->vpn0) * 4;
+      if (model_walk) AccessCache(pte_addr, false);
       pte_val = bus_->ReadWord(pte_addr);
       // check if is a valid PTE
       if (!pte->v || (!pte->r && pte->w)) PAGE_FAULT;
@@ -151,13 +158,19 @@ bool MMU::CheckPTEProperty(const Sv32PTE &pte, bool is_store,
 std::uint8_t MMU::ReadByte(std::uint32_t addr) {
   if (is_invalid_) return 0;
   auto pa = GetPhysicalAddr(addr, false, false);
-  return is_invalid_ ? 0 : bus_->ReadByte(pa);
+  if (is_invalid_) return 0;
+  CheckWatch(addr, 1, false);
+  RecordAccess(pa, false);
+  return bus_->ReadByte(pa);
 }
 
 void MMU::WriteByte(std::uint32_t addr, std::uint8_t value) {
   if (is_invalid_) return;
   auto pa = GetPhysicalAddr(addr, true, false);
   if (!is_invalid_) {
+    CheckWatch(addr, 1, true);
+    RecordAccess(pa, true);
+    RecordStore(value);
     bus_->WriteByte(pa, value);
   }
 }
@@ -165,13 +178,19 @@ void MMU::WriteByte(std::uint32_t addr, std::uint8_t value) {
 std::uint16_t MMU::ReadHalf(std::uint32_t addr) {
   if (is_invalid_) return 0;
   auto pa = GetPhysicalAddr(addr, false, false);
-  return is_invalid_ ? 0 : bus_->ReadHalf(pa);
+  if (is_invalid_) return 0;
+  CheckWatch(addr, 2, false);
+  RecordAccess(pa, false);
+  return bus_->ReadHalf(pa);
 }
 
 void MMU::WriteHalf(std::uint32_t addr, std::uint16_t value) {
   if (is_invalid_) return;
   auto pa = GetPhysicalAddr(addr, true, false);
   if (!is_invalid_) {
+    CheckWatch(addr, 2, true);
+    RecordAccess(pa, true);
+    RecordStore(value);
     bus_->WriteHalf(pa, value);
   }
 }
@@ -179,19 +198,28 @@ void MMU::WriteHalf(std::uint32_t addr, std::uint16_t value) {
 std::uint32_t MMU::ReadWord(std::uint32_t addr) {
   if (is_invalid_) return 0;
   auto pa = GetPhysicalAddr(addr, false, false);
-  return is_invalid_ ? 0 : bus_->ReadWord(pa);
+  if (is_invalid_) return 0;
+  CheckWatch(addr, 4, false);
+  RecordAccess(pa, false);
+  return bus_->ReadWord(pa);
 }
 
 void MMU::WriteWord(std::uint32_t addr, std::uint32_t value) {
   if (is_invalid_) return;
   auto pa = GetPhysicalAddr(addr, true, false);
   if (!is_invalid_) {
+    CheckWatch(addr, 4, true);
+    RecordAccess(pa, true);
+    RecordStore(value);
     bus_->WriteWord(pa, value);
   }
 }
 
 std::uint32_t MMU::ReadInst(std::uint32_t addr) {
+  SELF_PROFILE_SCOPE(Fetch);
   if (is_invalid_) return 0;
   auto pa = GetPhysicalAddr(addr, false, true);
-  return is_invalid_ ? 0 : bus_->ReadWord(pa);
+  if (is_invalid_) return 0;
+  if (cache_) cache_->Fetch(pa);
+  return bus_->ReadWord(pa);
 }
@@ -6,11 +6,16 @@
 #include "peripheral/peripheral.h"
 #include "core/control/csr.h"
 #include "define/vm.h"
+#include "bus/watchpoint.h"
+#include "bus/cache.h"
 
 class MMU : public PeripheralInterface {
  public:
   MMU(CSR &csr, const PeripheralPtr &bus)
-      : csr_(csr), bus_(bus), is_invalid_(false), last_vaddr_(0) {}
+      : csr_(csr), bus_(bus), is_invalid_(false), last_vaddr_(0),
+        last_paddr_(0), last_store_data_(0), access_count_(0),
+        store_count_(0),
+        watches_(nullptr), cache_(nullptr), page_walk_count_(0) {}
 
   std::uint8_t ReadByte(std::uint32_t addr) override;
   void WriteByte(std::uint32_t addr, std::uint8_t value) override;
@@ -25,23 +30,60 @@ class MMU : public PeripheralInterface {
 
   // setters
   void set_is_invalid(bool is_invalid) { is_invalid_ = is_invalid; }
+  // data watchpoints checked on loads & stores
+  void set_watches(WatchpointSet *watches) { watches_ = watches; }
+  // cache model of physical accesses
+  void set_cache(CacheModel *cache) { cache_ = cache; }
 
   // getters
   // check if last operation is invalid
   bool is_invalid() const { return is_invalid_; }
   // last virtual address
   std::uint32_t last_vaddr() const { return last_vaddr_; }
+  // physical address of last data access
+  std::uint32_t last_paddr() const { return last_paddr_; }
+  // data of last store (zero-extended to 32 bits)
+  std::uint32_t last_store_data() const { return last_store_data_; }
+  // count of performed data accesses & stores, changes only if an
+  // access/store is performed
+  std::uint64_t access_count() const { return access_count_; }
+  std::uint64_t store_count() const { return store_count_; }
+  // count of page table walks
+  std::uint64_t page_walk_count() const { return page_walk_count_; }
 
  private:
   std::uint32_t GetPhysicalAddr(std::uint32_t addr, bool is_store,
                                 bool is_execute);
   bool CheckPTEProperty(const Sv32PTE &pte, bool is_store,
                         bool is_execute);
+  // check data watchpoints
+  void CheckWatch(std::uint32_t addr, std::uint32_t len, bool is_store) {
+    if (watches_) watches_->Check(addr, len, is_store);
+  }
+  // model data access of physical address in cache
+  void AccessCache(std::uint32_t addr, bool is_store) {
+    if (cache_) cache_->Access(addr, is_store);
+  }
+  // record physical address of data access
+  void RecordAccess(std::uint32_t addr, bool is_store) {
+    last_paddr_ = addr;
+    ++access_count_;
+    AccessCache(addr, is_store);
+  }
+  // record data of performed store
+  void RecordStore(std::uint32_t value) {
+    last_store_data_ = value;
+    ++store_count_;
+  }
 
   CSR &csr_;
   PeripheralPtr bus_;
   bool is_invalid_;
-  std::uint32_t last_vaddr_;
+  std::uint32_t last_vaddr_, last_paddr_, last_store_data_;
+  std::uint64_t access_count_, store_count_;
+  WatchpointSet *watches_;
+  CacheModel *cache_;
+  std::uint64_t page_walk_count_;
 };
 
 #endif  // RISKY32_BUS_MMU_H_
@@ -0,0 +1,80 @@
+#include "bus/watchpoint.h"
+
+#include <cassert>
+
+namespace {
+
+// count of pages in 32-bit address space
+constexpr std::uint64_t kPageCount = std::uint64_t(1) << 20;
+
+}  // namespace
+
+void WatchpointSet::Add(std::uint32_t id, std::uint32_t addr,
+                        std::uint32_t len, Kind kind) {
+  assert(len);
+  watches_.push_back({id, addr, len, kind});
+  RebuildPages();
+}
+
+bool WatchpointSet::Remove(std::uint32_t id) {
+  for (auto it = watches_.begin(); it != watches_.end(); ++it) {
+    if (it->id == id) {
+      watches_.erase(it);
+      RebuildPages();
+      return true;
+    }
+  }
+  return false;
+}
+
+bool WatchpointSet::Remove(std::uint32_t addr, std::uint32_t len,
+                           Kind kind) {
+  for (auto it = watches_.begin(); it != watches_.end(); ++it) {
+    if (it->addr == addr && it->len == len && it->kind == kind) {
+      watches_.erase(it);
+      RebuildPages();
+      return true;
+    }
+  }
+  return false;
+}
+
+void WatchpointSet::Clear() {
+  watches_.clear();
+  RebuildPages();
+}
+
+void WatchpointSet::CheckRanges(std::uint32_t addr, std::uint32_t len,
+                                bool is_store) {
+  auto kind = is_store ? kWrite : kRead;
+  for (std::size_t i = 0; i < watches_.size(); ++i) {
+    const auto &info = watches_[i];
+    // check if access overlaps with watched range
+    std::uint64_t begin = addr, watch_begin = info.addr;
+    if ((info.kind & kind) && begin < watch_begin + info.len &&
+        watch_begin < begin + len) {
+      hit_ = true;
+      hit_store_ = is_store;
+      hit_addr_ = addr;
+      hit_index_ = i;
+      return;
+    }
+  }
+}
+
+void WatchpointSet::RebuildPages() {
+  if (watches_.empty()) {
+    // release bitmap
+    std::vector<std::uint64_t>().swap(pages_);
+    return;
+  }
+  pages_.assign(kPageCount / 64, 0);
+  for (const auto &info : watches_) {
+    std::uint64_t first = info.addr >> kPageShift;
+    std::uint64_t last = (std::uint64_t(info.addr) + info.len - 1) >>
+                         kPageShift;
+    for (auto page = first; page <= last && page < kPageCount; ++page) {
+      pages_[page >> 6] |= std::uint64_t(1) << (page & 63);
+    }
+  }
+}
@@ -0,0 +1,91 @@
+#ifndef RISKY32_BUS_WATCHPOINT_H_
+#define RISKY32_BUS_WATCHPOINT_H_
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// set of data watchpoints, checked by MMU on loads & stores only
+// a bitmap of watched pages filters out most accesses, so that
+// unwatched code runs at nearly full speed
+class WatchpointSet {
+ public:
+  // kind of watchpoints
+  enum Kind : std::uint8_t {
+    kRead = 1 << 0, kWrite = 1 << 1, kAccess = kRead | kWrite,
+  };
+
+  // information of watchpoint
+  struct Watchpoint {
+    // user defined id
+    std::uint32_t id;
+    // watched address range
+    std::uint32_t addr, len;
+    // kind of watchpoint
+    Kind kind;
+  };
+
+  WatchpointSet()
+      : hit_(false), hit_store_(false), hit_addr_(0), hit_index_(0) {}
+
+  // add a watchpoint
+  void Add(std::uint32_t id, std::uint32_t addr, std::uint32_t len,
+           Kind kind);
+  // remove watchpoint by id, returns false if not found
+  bool Remove(std::uint32_t id);
+  // remove watchpoint by address range & kind, returns false if not found
+  bool Remove(std::uint32_t addr, std::uint32_t len, Kind kind);
+  // remove all watchpoints
+  void Clear();
+
+  // check a memory access (virtual address)
+  void Check(std::uint32_t addr, std::uint32_t len, bool is_store) {
+    if (!pages_.empty() &&
+        (IsPageWatched(addr) || IsPageWatched(addr + len - 1))) {
+      CheckRanges(addr, len, is_store);
+    }
+  }
+  // clear hit flag, returns true if any watchpoint has been hit
+  bool CheckAndClearHit() {
+    auto hit = hit_;
+    hit_ = false;
+    return hit;
+  }
+
+  // getters
+  // check if there is no watchpoint
+  bool empty() const { return watches_.empty(); }
+  // all watchpoints
+  const std::vector<Watchpoint> &watches() const { return watches_; }
+  // the last hit watchpoint
+  const Watchpoint &hit_watch() const { return watches_[hit_index_]; }
+  // address of the last hit access
+  std::uint32_t hit_addr() const { return hit_addr_; }
+  // check if the last hit access is a store
+  bool hit_store() const { return hit_store_; }
+
+ private:
+  // size of page in bitmap
+  static const std::uint32_t kPageShift = 12;
+
+  // check if specific page is watched
+  bool IsPageWatched(std::uint32_t addr) const {
+    auto page = addr >> kPageShift;
+    return pages_[page >> 6] & (std::uint64_t(1) << (page & 63));
+  }
+  // check access in all ranges
+  void CheckRanges(std::uint32_t addr, std::uint32_t len, bool is_store);
+  // rebuild bitmap of watched pages
+  void RebuildPages();
+
+  // all watchpoints
+  std::vector<Watchpoint> watches_;
+  // bitmap of watched pages (empty if there is no watchpoint)
+  std::vector<std::uint64_t> pages_;
+  // hit information
+  bool hit_, hit_store_;
+  std::uint32_t hit_addr_;
+  std::size_t hit_index_;
+};
+
+#endif  // RISKY32_BUS_WATCHPOINT_H_
@@ -1,9 +1,11 @@
 #include "core/control/csr.h"
 
+#include <cassert>
+
 namespace {
 
 // get privilege level by address of CSR
-inline int GetPrivByCSRAddr(std::uint32_t addr) {
+inline std::uint32_t GetPrivByCSRAddr(std::uint32_t addr) {
   return (addr >> 8) & 0b11;
 }
 
@@ -99,9 +101,9 @@ CSR::CSR() {
   InitMapping();
 }
 
-void CSR::UpdateCSR() {
+void CSR::UpdateCSR(std::uint32_t cycles) {
   // update counters
-  ++mcycle_;
+  mcycle_ += cycles;
   ++minstret_;
 }
 
@@ -185,8 +187,48 @@ bool CSR::WriteData(std::uint32_t addr, std::uint32_t value) {
   }
 }
 
+void CSR::SaveState(SnapshotWriter &writer) const {
+  writer.BeginSection("CSR");
+  writer.Write(cur_priv_);
+  // supervisor mode CSRs
+  writer.Write(sstatus_);
+  writer.Write(sscratch_);
+  writer.Write(sepc_);
+  writer.Write(satp_);
+  // machine mode CSRs
+  writer.Write(mstatus_);
+  writer.Write(misa_);
+  writer.Write(mie_);
+  writer.Write(mtvec_);
+  writer.Write(mscratch_);
+  writer.Write(mepc_);
+  writer.Write(mcause_);
+  writer.Write(mtval_);
+  writer.Write(mip_);
+  // machine mode counters
+  writer.Write(mcycle_);
+  writer.Write(minstret_);
+}
+
+bool CSR::LoadState(SnapshotReader &reader) {
+  return reader.CheckSection("CSR") && reader.Read(cur_priv_) &&
+         reader.Read(sstatus_) && reader.Read(sscratch_) &&
+         reader.Read(sepc_) && reader.Read(satp_) &&
+         reader.Read(mstatus_) && reader.Read(misa_) &&
+         reader.Read(mie_) && reader.Read(mtvec_) &&
+         reader.Read(mscratch_) && reader.Read(mepc_) &&
+         reader.Read(mcause_) && reader.Read(mtval_) &&
+         reader.Read(mip_) && reader.Read(mcycle_) &&
+         reader.Read(minstret_);
+}
+
 std::uint32_t CSR::ReadDataForce(std::uint32_t addr) {
   auto it = csrs_.find(addr);
   assert(it != csrs_.end());
   return *it->second;
 }
+
+const std::uint32_t *CSR::GetDataPtr(std::uint32_t addr) const {
+  auto it = csrs_.find(addr);
+  return it == csrs_.end() ? nullptr : it->second;
+}
@@ -6,6 +6,7 @@
 
 #include "define/csr.h"
 #include "util/cast.h"
+#include "util/snapshot.h"
 
 // control and status registers
 class CSR {
@@ -13,13 +14,20 @@ class CSR {
   CSR();
 
   // update CSRs (e.g. performance counters)
-  void UpdateCSR();
+  // 'cycles' is count of cycles taken by the last instruction
+  void UpdateCSR(std::uint32_t cycles = 1);
   // read data from CSR, returns false if failed
   bool ReadData(std::uint32_t addr, std::uint32_t &value);
   // write data to CSR, returns false if failed
   bool WriteData(std::uint32_t addr, std::uint32_t value);
   // read data but ignores current privilege level
   std::uint32_t ReadDataForce(std::uint32_t addr);
+  // get pointer to data of CSR, returns 'nullptr' if CSR does not exist
+  const std::uint32_t *GetDataPtr(std::uint32_t addr) const;
+  // save all CSRs to snapshot
+  void SaveState(SnapshotWriter &writer) const;
+  // restore all CSRs from snapshot, returns false if failed
+  bool LoadState(SnapshotReader &reader);
 
   // setters
   void set_cur_priv(std::uint32_t cur_priv) { cur_priv_ = cur_priv; }
@@ -4,7 +4,11 @@
 
 #include "define/exception.h"
 #include "define/inst.h"
+#include "define/insttab.h"
 #include "util/cast.h"
+#include "util/instmix.h"
+#include "util/bbv.h"
+#include "util/selfprof.h"
 
 // functional units
 #include "core/unit/int.h"
@@ -26,125 +30,171 @@ void Core::InitUnits() {
   auto load_store   = std::make_shared<LoadStoreUnit>();
   auto branch_unit  = std::make_shared<BranchUnit>();
   auto system_unit  = std::make_shared<SystemUnit>();
-  // initialize unit map
-  units_[kLoad]     = load_store;
-  units_[kMiscMem]  = load_store;
-  units_[kOpImm]    = int_unit;
-  units_[kAUIPC]    = int_unit;
-  units_[kStore]    = load_store;
-  units_[kAMO]      = load_store;
-  units_[kOp]       = int_unit;
-  units_[kLUI]      = int_unit;
-  units_[kBranch]   = branch_unit;
-  units_[kJALR]     = branch_unit;
-  units_[kJAL]      = branch_unit;
-  units_[kSystem]   = system_unit;
+  // initialize unit table
+  units_[static_cast<int>(InstUnit::Int)]       = int_unit;
+  units_[static_cast<int>(InstUnit::LoadStore)] = load_store;
+  units_[static_cast<int>(InstUnit::Branch)]    = branch_unit;
+  units_[static_cast<int>(InstUnit::System)]    = system_unit;
 }
 
 void Core::Execute(std::uint32_t inst_data, CoreState &state) {
-  // select functional unit
-  auto inst = PtrCast<Inst>(&inst_data);
-  auto it = units_.find(inst->opcode);
-  if (it == units_.end()) {
+  SELF_PROFILE_SCOPE(Execute);
+  // decode & select functional unit
+  const auto &info = kInstTable[DecodeInst(inst_data)];
+  const auto &unit = units_[static_cast<int>(info.unit)];
+  if (!unit) {
     // illegal instruction
     state.RaiseException(kExcIllegalInst, inst_data);
+    return;
   }
-  else {
-    // decode & execute
-    switch (inst->opcode) {
-      // R-type
-      case kAMO: case kOp: {
-        auto inst_r = PtrCast<InstR>(&inst_data);
-        it->second->ExecuteR(*inst_r, state);
-        // check MMU exception
-        CHECK_PAGE_FAULT(kExcStAMOPageFault);
-        break;
-      }
-      // I-type
-      case kLoad: case kMiscMem: case kJALR: {
-        auto inst_i = PtrCast<InstI>(&inst_data);
-        it->second->ExecuteI(*inst_i, state);
-        // check MMU exception
-        CHECK_PAGE_FAULT(kExcLoadPageFault);
-        break;
-      }
-      // S-type
-      case kStore: case kBranch: {
-        auto inst_s = PtrCast<InstS>(&inst_data);
-        it->second->ExecuteS(*inst_s, state);
-        // check MMU exception
-        CHECK_PAGE_FAULT(kExcStAMOPageFault);
-        break;
-      }
-      // U-type
-      case kAUIPC: case kLUI: case kJAL: {
-        auto inst_u = PtrCast<InstU>(&inst_data);
-        it->second->ExecuteU(*inst_u, state);
-        break;
-      }
-      // other (immediate)
-      case kOpImm: {
-        auto inst_i = PtrCast<InstI>(&inst_data);
-        switch (inst_i->funct3) {
-          case kSLLI: case kSRXI: {
-            // treat 'SLLI', 'SRLI' and 'SRAI' as R-type
-            auto inst_r = PtrCast<InstR>(&inst_data);
-            it->second->ExecuteR(*inst_r, state);
-            break;
-          }
-          default: {
-            it->second->ExecuteI(*inst_i, state);
-            break;
-          }
-        }
-        break;
-      }
-      // other (system)
-      case kSystem: {
-        auto inst_r = PtrCast<InstR>(&inst_data);
-        if (inst_r->funct3 == kPRIV && inst_r->funct7 == kSFENCE) {
-          // 'SFENCE.VMA' instruction
-          it->second->ExecuteR(*inst_r, state);
-        }
-        else {
-          // other privileged instructions
-          auto inst_i = PtrCast<InstI>(&inst_data);
-          it->second->ExecuteI(*inst_i, state);
-        }
-        break;
-      }
-      default: {
-        // just ignore
-        // since 'illegal instruction' exception has been handled before
-        assert(false);
-        break;
-      }
+  // execute
+  switch (info.format) {
+    case InstFormat::R: {
+      auto inst_r = PtrCast<InstR>(&inst_data);
+      unit->ExecuteR(*inst_r, state);
+      // check MMU exception
+      CHECK_PAGE_FAULT(kExcStAMOPageFault);
+      break;
+    }
+    case InstFormat::I: {
+      auto inst_i = PtrCast<InstI>(&inst_data);
+      unit->ExecuteI(*inst_i, state);
+      // check MMU exception
+      CHECK_PAGE_FAULT(kExcLoadPageFault);
+      break;
+    }
+    case InstFormat::S: {
+      auto inst_s = PtrCast<InstS>(&inst_data);
+      unit->ExecuteS(*inst_s, state);
+      // check MMU exception
+      CHECK_PAGE_FAULT(kExcStAMOPageFault);
+      break;
+    }
+    case InstFormat::U: {
+      auto inst_u = PtrCast<InstU>(&inst_data);
+      unit->ExecuteU(*inst_u, state);
+      break;
     }
+    default: assert(false);
   }
 }
 
-void Core::WriteBack(CoreState &state) {
+template <typename Instrument>
+void Core::WriteBack(std::uint32_t inst_data, CoreState &state,
+                     std::uint32_t priv, Instrument &instrument) {
+  SELF_PROFILE_SCOPE(WriteBack);
   // handle interrupt & exception
   if (state.next_pc() & 0b11) {
     state.RaiseException(kExcInstAddrMisalign, state.next_pc());
   }
   state.CheckInterrupt();
+  std::uint32_t cycles = 1;
   if (!state.CheckAndClearExcFlag()) {
     // no exception, perform write back operation
+    if (has_hooks_) cycles = RetireHooks(inst_data, state);
     state_ = state;
+    ++retired_count_;
+    instrument.Retire(state.pc(), inst_data, state.next_pc(), priv);
+  }
+  else {
+    if (csr_.mcause() & 0x80000000) {
+      ++interrupt_count_;
+    }
+    else {
+      ++exception_count_;
+    }
+    instrument.Trap(priv);
+    if (has_hooks_) cycles = TrapHooks(state);
   }
   // prepare for next cycle
   state_.regs(0) = 0;
   state_.pc() = state.next_pc();
-  csr_.UpdateCSR();
+  csr_.UpdateCSR(cycles);
   state_.LatchCSR();
 }
 
+std::uint32_t Core::RetireHooks(std::uint32_t inst_data,
+                                CoreState &state) {
+  // called before 'state_' is updated
+  // check if the instruction has accessed memory or performed a store
+  auto is_access = mmu_.access_count() != access_count_;
+  auto is_store = mmu_.store_count() != store_count_;
+  access_count_ = mmu_.access_count();
+  store_count_ = mmu_.store_count();
+  if (tracer_) {
+    // address of AMO is the old value of 'rs1', since failed 'sc.w'
+    // does not access memory
+    auto addr = (inst_data & 0x7f) == kAMO
+                    ? state_.regs((inst_data >> 15) & 0x1f)
+                    : mmu_.last_vaddr();
+    tracer_->Retire(state.pc(), inst_data,
+                    state.regs((inst_data >> 7) & 0x1f), addr, is_store,
+                    mmu_.last_store_data());
+  }
+  if (checker_) {
+    checker_->Retire(state.pc(), inst_data,
+                     state.regs((inst_data >> 7) & 0x1f));
+  }
+  if (profiler_) profiler_->Count(state.pc());
+  if (trap_stats_) {
+    trap_stats_->Update(csr_.mip());
+    trap_stats_->Retire(inst_data);
+  }
+  if (call_graph_) {
+    call_graph_->Retire(state.pc(), inst_data, state.next_pc());
+  }
+  if (branch_model_) {
+    branch_model_->Retire(state.pc(), inst_data, state.next_pc());
+  }
+  if (timing_) {
+    return timing_->Retire(state.pc(), inst_data, state.next_pc(),
+                           is_access, mmu_.last_paddr());
+  }
+  return 1;
+}
+
+std::uint32_t Core::TrapHooks(CoreState &state) {
+  // ignore accesses of instructions that did not retire
+  access_count_ = mmu_.access_count();
+  store_count_ = mmu_.store_count();
+  if (checker_ && !(csr_.mcause() & 0x80000000)) {
+    checker_->Trap(state.pc());
+  }
+  if (trap_stats_) {
+    trap_stats_->Update(csr_.mip());
+    trap_stats_->Trap(csr_.mcause());
+  }
+  if (call_graph_) call_graph_->Trap(state.next_pc());
+  if (timing_) return timing_->Trap();
+  return 1;
+}
+
 void Core::Reset() {
   state_.Reset();
+  retired_count_ = 0;
+  exception_count_ = interrupt_count_ = 0;
+}
+
+void Core::SaveState(SnapshotWriter &writer) const {
+  writer.BeginSection("CORE");
+  state_.SaveState(writer);
+  exc_mon_.SaveState(writer);
+  csr_.SaveState(writer);
+  writer.Write(retired_count_);
+  writer.Write(exception_count_);
+  writer.Write(interrupt_count_);
+}
+
+bool Core::LoadState(SnapshotReader &reader) {
+  return reader.CheckSection("CORE") && state_.LoadState(reader) &&
+         exc_mon_.LoadState(reader) && csr_.LoadState(reader) &&
+         reader.Read(retired_count_) && reader.Read(exception_count_) &&
+         reader.Read(interrupt_count_);
 }
 
-void Core::NextCycle() {
+template <typename Instrument>
+void Core::NextCycle(Instrument &instrument) {
+  auto priv = csr_.cur_priv();
   // reset MMU state
   mmu_.set_is_invalid(false);
   // fetch instruction
@@ -160,18 +210,13 @@ void Core::NextCycle() {
     Execute(inst_data, state);
   }
   // perform write back
-  WriteBack(state);
+  WriteBack(inst_data, state, priv, instrument);
 }
 
-void Core::ReExecute(std::uint32_t inst_data) {
-  // reset MMU state
-  mmu_.set_is_invalid(false);
-  // fetch instruction (dummy)
-  state_.pc() -= 4;
-  auto state = state_;
-  state.next_pc() = state.pc() + 4;
-  // dispatch and execute
-  Execute(inst_data, state);
-  // perform write back
-  WriteBack(state);
-}
+// instantiate execution loops of all instrumentation policies
+template void Core::NextCycle(NoInstrument &instrument);
+template void Core::NextCycle(InstMixStats &instrument);
+template void Core::NextCycle(BBVCollector &instrument);
+template void Core::NextCycle(
+    InstrumentPair<InstMixStats, BBVCollector> &instrument);
+
@@ -1,7 +1,6 @@
 #ifndef RISKY32_CORE_CORE_H_
 #define RISKY32_CORE_CORE_H_
 
-#include <unordered_map>
 #include <cstdint>
 #include <cstddef>
 
@@ -11,27 +10,127 @@
 #include "core/storage/state.h"
 #include "core/storage/excmon.h"
 #include "core/unit.h"
+#include "core/timing.h"
+#include "define/insttab.h"
+#include "util/profiler.h"
+#include "util/callgraph.h"
+#include "util/branchpred.h"
+#include "util/tracer.h"
+#include "util/lockstep.h"
+#include "util/trapstats.h"
+
+// instrumentation policy of execution loop that does nothing
+// policies observe retired instructions & traps, and are selected by
+// template argument of 'Core::NextCycle', so that the default loop
+// pays nothing for disabled instrumentation
+// other optional hooks of core (profiler, tracer, etc.) are checked
+// by a single flag in each cycle
+struct NoInstrument {
+  void Retire(std::uint32_t pc, std::uint32_t inst_data,
+              std::uint32_t next_pc, std::uint32_t priv) {}
+  void Trap(std::uint32_t priv) {}
+};
+
+// instrumentation policy that forwards to two policies
+template <typename First, typename Second>
+struct InstrumentPair {
+  First &first;
+  Second &second;
+
+  void Retire(std::uint32_t pc, std::uint32_t inst_data,
+              std::uint32_t next_pc, std::uint32_t priv) {
+    first.Retire(pc, inst_data, next_pc, priv);
+    second.Retire(pc, inst_data, next_pc, priv);
+  }
+  void Trap(std::uint32_t priv) {
+    first.Trap(priv);
+    second.Trap(priv);
+  }
+};
 
 class Core {
  public:
   Core(const PeripheralPtr &bus)
       : timer_int_(nullptr), soft_int_(nullptr), ext_int_(nullptr),
-        bus_(bus), mmu_(csr_, bus), state_(*this) {
+        bus_(bus), mmu_(csr_, bus), state_(*this), retired_count_(0),
+        exception_count_(0), interrupt_count_(0),
+        profiler_(nullptr), call_graph_(nullptr), branch_model_(nullptr),
+        timing_(nullptr), tracer_(nullptr), checker_(nullptr),
+        trap_stats_(nullptr), has_hooks_(false), access_count_(0),
+        store_count_(0) {
     InitUnits();
   }
 
   // reset the state of current core
   void Reset();
   // run a cycle
-  void NextCycle();
-  // rewind 1 instruction and then execute specific instruction
-  // (used by debugger)
-  void ReExecute(std::uint32_t inst_data);
+  void NextCycle() {
+    NoInstrument none;
+    NextCycle(none);
+  }
+  // run a cycle with specific instrumentation policy
+  template <typename Instrument>
+  void NextCycle(Instrument &instrument);
+  // save state of core (including CSRs) to snapshot
+  void SaveState(SnapshotWriter &writer) const;
+  // restore state of core from snapshot, returns false if failed
+  bool LoadState(SnapshotReader &reader);
 
   // setters
   void set_timer_int(const bool *timer_int) { timer_int_ = timer_int; }
   void set_soft_int(const bool *soft_int) { soft_int_ = soft_int; }
   void set_ext_int(const bool *ext_int) { ext_int_ = ext_int; }
+  // data watchpoints
+  void set_watches(WatchpointSet *watches) { mmu_.set_watches(watches); }
+  // cache model of memory accesses
+  void set_cache(CacheModel *cache) {
+    mmu_.set_cache(cache);
+    cache->set_pc(&state_.pc());
+  }
+  // profiler of retired instructions
+  void set_profiler(Profiler *profiler) {
+    profiler_ = profiler;
+    UpdateHooks();
+  }
+  // call-graph profiler
+  void set_call_graph(CallGraphProfiler *call_graph) {
+    call_graph_ = call_graph;
+    UpdateHooks();
+  }
+  // branch prediction model
+  void set_branch_model(BranchModel *branch_model) {
+    branch_model_ = branch_model;
+    UpdateHooks();
+  }
+  // pipeline timing model (drives 'mcycle')
+  void set_timing(TimingModel *timing) {
+    timing_ = timing;
+    UpdateHooks();
+  }
+  // writer of execution trace
+  void set_tracer(TraceWriter *tracer) {
+    tracer_ = tracer;
+    UpdateHooks();
+  }
+  // lockstep checker against reference commit log
+  void set_checker(LockstepChecker *checker) {
+    checker_ = checker;
+    UpdateHooks();
+  }
+  // statistics of traps & interrupt latencies
+  void set_trap_stats(TrapStats *trap_stats) {
+    trap_stats_ = trap_stats;
+    UpdateHooks();
+  }
+  // value of specific register (32 for program counter)
+  void set_regs(std::size_t addr, std::uint32_t value) {
+    if (addr == 32) {
+      state_.pc() = value;
+    }
+    else if (addr) {
+      state_.regs(addr) = value;
+    }
+  }
 
   // getters
   // timer interrupt
@@ -54,14 +153,36 @@ class Core {
   }
   // value of program counter
   std::uint32_t pc() { return state_.pc(); }
+  // count of retired instructions
+  // (maintained by host, not affected by writes to 'minstret')
+  const std::uint64_t *retired_count() const { return &retired_count_; }
+  // count of taken exceptions & interrupts (maintained by host)
+  std::uint64_t exception_count() const { return exception_count_; }
+  std::uint64_t interrupt_count() const { return interrupt_count_; }
+  // memory management unit
+  const MMU &mmu() const { return mmu_; }
 
  private:
   // initialize all functional units
   void InitUnits();
   // dispatch and execute
   void Execute(std::uint32_t inst_data, CoreState &state);
-  // write back
-  void WriteBack(CoreState &state);
+  // write back, 'priv' is the privilege level of instruction
+  template <typename Instrument>
+  void WriteBack(std::uint32_t inst_data, CoreState &state,
+                 std::uint32_t priv, Instrument &instrument);
+  // run optional hooks on retired instruction or trap,
+  // returns cycles taken by the instruction
+  std::uint32_t RetireHooks(std::uint32_t inst_data,
+                            CoreState &state);
+  std::uint32_t TrapHooks(CoreState &state);
+  // update flag of optional hooks
+  void UpdateHooks() {
+    has_hooks_ = profiler_ || call_graph_ || branch_model_ || timing_ ||
+                 tracer_ || checker_ || trap_stats_;
+    access_count_ = mmu_.access_count();
+    store_count_ = mmu_.store_count();
+  }
 
   // interrupt signals
   const bool *timer_int_, *soft_int_, *ext_int_;
@@ -75,8 +196,31 @@ class Core {
   ExclusiveMonitor exc_mon_;
   // internal state
   CoreState state_;
-  // functional units
-  std::unordered_map<std::uint32_t, UnitPtr> units_;
+  // retired instruction count
+  std::uint64_t retired_count_;
+  // count of taken exceptions & interrupts
+  std::uint64_t exception_count_, interrupt_count_;
+  // profiler (null if disabled)
+  Profiler *profiler_;
+  // call-graph profiler (null if disabled)
+  CallGraphProfiler *call_graph_;
+  // branch prediction model (null if disabled)
+  BranchModel *branch_model_;
+  // pipeline timing model (null if disabled)
+  TimingModel *timing_;
+  // writer of execution trace (null if disabled)
+  TraceWriter *tracer_;
+  // lockstep checker (null if disabled)
+  LockstepChecker *checker_;
+  // statistics of traps (null if disabled)
+  TrapStats *trap_stats_;
+  // set if any of the optional hooks above is enabled
+  bool has_hooks_;
+  // data access & store count of MMU after the last cycle
+  // (maintained only if hooks are enabled)
+  std::uint64_t access_count_, store_count_;
+  // functional units (indexed by 'InstUnit')
+  UnitPtr units_[kInstUnitCount];
 };
 
 #endif  // RISKY32_CORE_CORE_H_
@@ -3,6 +3,8 @@
 
 #include <cstdint>
 
+#include "util/snapshot.h"
+
 // exclusive monitor
 class ExclusiveMonitor {
  public:
@@ -22,6 +24,15 @@ class ExclusiveMonitor {
     return flag_ && addr_ == addr;
   }
 
+  void SaveState(SnapshotWriter &writer) const {
+    writer.Write(flag_);
+    writer.Write(addr_);
+  }
+
+  bool LoadState(SnapshotReader &reader) {
+    return reader.Read(flag_) && reader.Read(addr_);
+  }
+
  private:
   bool flag_;
   std::uint32_t addr_;
@@ -123,6 +123,21 @@ void CoreState::LatchCSR() {
   last_mie_ = core_.csr().mie();
 }
 
+void CoreState::SaveState(SnapshotWriter &writer) const {
+  writer.Write(regs_);
+  writer.Write(pc_);
+  writer.Write(next_pc_);
+  writer.Write(exc_code_);
+  writer.Write(last_mstatus_);
+  writer.Write(last_mie_);
+}
+
+bool CoreState::LoadState(SnapshotReader &reader) {
+  return reader.Read(regs_) && reader.Read(pc_) && reader.Read(next_pc_) &&
+         reader.Read(exc_code_) && reader.Read(last_mstatus_) &&
+         reader.Read(last_mie_);
+}
+
 void CoreState::RaiseException(std::uint32_t exc_code) {
   RaiseException(exc_code, 0);
 }
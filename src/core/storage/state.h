@@ -3,10 +3,12 @@
 
 #include <cstdint>
 #include <cstdlib>
+#include <cstring>
 
 #include "peripheral/peripheral.h"
 #include "core/control/csr.h"
 #include "core/storage/excmon.h"
+#include "util/snapshot.h"
 
 // forward declaration of 'Core'
 class Core;
@@ -19,7 +21,7 @@ class CoreState {
   // copy operator
   CoreState &operator=(const CoreState &rhs) {
     if (&rhs != this) {
-      std::memcpy(this, &rhs, sizeof(CoreState));
+      std::memcpy(static_cast<void *>(this), &rhs, sizeof(CoreState));
     }
     return *this;
   }
@@ -32,6 +34,10 @@ class CoreState {
   void CheckInterrupt();
   // latch CSR info (avoid asynchronous exception deadlocks)
   void LatchCSR();
+  // save state to snapshot
+  void SaveState(SnapshotWriter &writer) const;
+  // restore state from snapshot, returns false if failed
+  bool LoadState(SnapshotReader &reader);
 
   // raise an exception
   void RaiseException(std::uint32_t exc_code);
@@ -0,0 +1,136 @@
+#include "core/timing.h"
+
+#include <fstream>
+#include <iomanip>
+#include <string>
+
+#include "define/inst.h"
+#include "util/cast.h"
+
+namespace {
+
+// extra cycles of multiplication & division in EX stage
+constexpr std::uint32_t kMulStalls = 2;
+constexpr std::uint32_t kDivStalls = 32;
+// cycles flushed by jumps resolved in ID stage ('jal')
+constexpr std::uint32_t kJumpPenalty = 1;
+// cycles flushed by control flow changes resolved in EX stage
+constexpr std::uint32_t kBranchPenalty = 2;
+// cycles flushed by traps (taken in MEM stage)
+constexpr std::uint32_t kTrapPenalty = 3;
+
+// get source registers read by instruction (0 if not used)
+inline void GetSourceRegs(const InstR &inst, std::uint32_t &rs1,
+                          std::uint32_t &rs2) {
+  rs1 = rs2 = 0;
+  switch (inst.opcode) {
+    case kOp: case kBranch: case kStore: case kAMO: {
+      rs1 = inst.rs1;
+      rs2 = inst.rs2;
+      break;
+    }
+    case kOpImm: case kLoad: case kJALR: {
+      rs1 = inst.rs1;
+      break;
+    }
+    case kSystem: {
+      // CSR instructions with register operand
+      if (inst.funct3 && !(inst.funct3 & 0b100)) rs1 = inst.rs1;
+      break;
+    }
+    default:;
+  }
+}
+
+// print a line of CPI breakdown
+void PrintLine(std::ostream &os, std::string_view name,
+               std::uint64_t cycles, std::uint64_t total,
+               std::uint64_t instructions) {
+  os << std::left << std::setw(10) << name << std::right << std::setw(14)
+     << cycles << std::fixed << std::setprecision(3) << std::setw(9)
+     << (instructions ? static_cast<double>(cycles) / instructions : 0.0)
+     << std::setprecision(2) << std::setw(9)
+     << (total ? cycles * 100.0 / total : 0.0) << "%" << std::endl;
+}
+
+}  // namespace
+
+std::uint32_t TimingModel::Retire(std::uint32_t pc,
+                                  std::uint32_t inst_data,
+                                  std::uint32_t next_pc, bool is_access,
+                                  std::uint32_t mem_addr) {
+  auto inst = PtrCast<InstR>(&inst_data);
+  std::uint32_t load_use = 0, mul_div = 0, control = 0, memory = 0;
+  // load-use hazard, value is forwarded from MEM stage
+  if (load_rd_) {
+    std::uint32_t rs1, rs2;
+    GetSourceRegs(*inst, rs1, rs2);
+    // store data is forwarded to MEM stage
+    if (inst->opcode == kStore) rs2 = 0;
+    if (rs1 == load_rd_ || rs2 == load_rd_) load_use = 1;
+  }
+  load_rd_ = 0;
+  switch (inst->opcode) {
+    case kLoad: case kAMO: {
+      if (is_access) {
+        load_rd_ = inst->rd;
+        memory = GetWaitStates(mem_addr);
+      }
+      break;
+    }
+    case kStore: {
+      memory = GetWaitStates(mem_addr);
+      break;
+    }
+    case kOp: {
+      if (inst->funct7 == kRV32M) {
+        mul_div = inst->funct3 < kDIV ? kMulStalls : kDivStalls;
+      }
+      break;
+    }
+    default:;
+  }
+  // control flow changes (including 'mret' & 'sret')
+  if (next_pc != pc + 4) {
+    control = inst->opcode == kJAL ? kJumpPenalty : kBranchPenalty;
+  }
+  // update statistics
+  ++instructions_;
+  ++cycles_[kCycleBase];
+  cycles_[kCycleLoadUse] += load_use;
+  cycles_[kCycleMulDiv] += mul_div;
+  cycles_[kCycleControl] += control;
+  cycles_[kCycleMemory] += memory;
+  return 1 + load_use + mul_div + control + memory;
+}
+
+std::uint32_t TimingModel::Trap() {
+  load_rd_ = 0;
+  cycles_[kCycleTrap] += 1 + kTrapPenalty;
+  return 1 + kTrapPenalty;
+}
+
+bool TimingModel::WriteReport(std::string_view file) const {
+  std::ofstream ofs{std::string(file)};
+  if (!ofs) return false;
+  std::uint64_t total = 0;
+  for (const auto &cycles : cycles_) total += cycles;
+  // print summary
+  ofs << "Pipeline timing (5-stage in-order):" << std::endl;
+  ofs << std::endl;
+  ofs << "instructions: " << instructions_ << std::endl;
+  ofs << "cycles:       " << total << std::endl;
+  ofs << "CPI:          " << std::fixed << std::setprecision(3)
+      << (instructions_ ? static_cast<double>(total) / instructions_ : 0.0)
+      << std::endl;
+  // print CPI breakdown
+  ofs << std::endl;
+  ofs << "component         cycles      CPI   percent" << std::endl;
+  PrintLine(ofs, "base", cycles_[kCycleBase], total, instructions_);
+  PrintLine(ofs, "load-use", cycles_[kCycleLoadUse], total, instructions_);
+  PrintLine(ofs, "mul/div", cycles_[kCycleMulDiv], total, instructions_);
+  PrintLine(ofs, "control", cycles_[kCycleControl], total, instructions_);
+  PrintLine(ofs, "memory", cycles_[kCycleMemory], total, instructions_);
+  PrintLine(ofs, "trap", cycles_[kCycleTrap], total, instructions_);
+  return static_cast<bool>(ofs);
+}
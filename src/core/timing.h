@@ -0,0 +1,67 @@
+#ifndef RISKY32_CORE_TIMING_H_
+#define RISKY32_CORE_TIMING_H_
+
+#include <string_view>
+#include <vector>
+#include <array>
+#include <cstdint>
+
+// cycle-approximate timing model of a classic 5-stage in-order pipeline
+// (IF, ID, EX, MEM, WB) with full forwarding
+// each retired instruction takes one cycle, plus stall cycles caused
+// by load-use hazards, multi-cycle multiplication & division, control
+// flow changes (predict-not-taken, 'jal' resolved in ID, others in EX),
+// wait states of data memories and traps
+class TimingModel {
+ public:
+  TimingModel() : load_rd_(0), instructions_(0), cycles_({}) {}
+
+  // set wait states of data accesses in an address range
+  void AddRegion(std::uint32_t base, std::uint32_t size,
+                 std::uint32_t wait_states) {
+    regions_.push_back({base, size, wait_states});
+  }
+
+  // handle a retired instruction, returns cycles taken by it
+  // 'mem_addr' is the physical address of its data access, if
+  // 'is_access' is set (failed 'sc.w' does not access memory)
+  std::uint32_t Retire(std::uint32_t pc, std::uint32_t inst_data,
+                       std::uint32_t next_pc, bool is_access,
+                       std::uint32_t mem_addr);
+  // handle a trap, returns cycles taken by it
+  std::uint32_t Trap();
+
+  // write CPI breakdown to file, returns false if failed
+  bool WriteReport(std::string_view file) const;
+
+ private:
+  // source of cycles
+  enum CycleKind {
+    kCycleBase, kCycleLoadUse, kCycleMulDiv, kCycleControl,
+    kCycleMemory, kCycleTrap, kCycleKindCount,
+  };
+
+  // address range with wait states
+  struct Region {
+    std::uint32_t base, size, wait_states;
+  };
+
+  // get wait states of data access
+  std::uint32_t GetWaitStates(std::uint32_t addr) const {
+    for (const auto &region : regions_) {
+      if (addr - region.base < region.size) return region.wait_states;
+    }
+    return 0;
+  }
+
+  // wait states of address ranges
+  std::vector<Region> regions_;
+  // destination register of the last load (0 if not a load)
+  std::uint32_t load_rd_;
+  // count of retired instructions
+  std::uint64_t instructions_;
+  // cycles of each kind
+  std::array<std::uint64_t, kCycleKindCount> cycles_;
+};
+
+#endif  // RISKY32_CORE_TIMING_H_
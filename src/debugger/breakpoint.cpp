@@ -0,0 +1,31 @@
+#include "debugger/breakpoint.h"
+
+bool BreakpointSet::Add(std::uint32_t addr) {
+  auto it = std::lower_bound(addrs_.begin(), addrs_.end(), addr);
+  if (it != addrs_.end() && *it == addr) return false;
+  addrs_.insert(it, addr);
+  auto bit = GetFilterBit(addr);
+  filter_[bit >> 6] |= std::uint64_t(1) << (bit & 63);
+  return true;
+}
+
+bool BreakpointSet::Remove(std::uint32_t addr) {
+  auto it = std::lower_bound(addrs_.begin(), addrs_.end(), addr);
+  if (it == addrs_.end() || *it != addr) return false;
+  addrs_.erase(it);
+  RebuildFilter();
+  return true;
+}
+
+void BreakpointSet::Clear() {
+  addrs_.clear();
+  RebuildFilter();
+}
+
+void BreakpointSet::RebuildFilter() {
+  for (auto &i : filter_) i = 0;
+  for (const auto &addr : addrs_) {
+    auto bit = GetFilterBit(addr);
+    filter_[bit >> 6] |= std::uint64_t(1) << (bit & 63);
+  }
+}
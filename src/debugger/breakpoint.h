@@ -0,0 +1,55 @@
+#ifndef RISKY32_DEBUGGER_BREAKPOINT_H_
+#define RISKY32_DEBUGGER_BREAKPOINT_H_
+
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+
+// set of PC breakpoints, kept on the host side (guest memory untouched)
+// a small bitmap filter rejects most addresses before the binary search
+// on sorted addresses, so that checking it for every PC is cheap
+class BreakpointSet {
+ public:
+  BreakpointSet() : filter_() {}
+
+  // add a breakpoint, returns false if it already exists
+  bool Add(std::uint32_t addr);
+  // remove a breakpoint, returns false if not found
+  bool Remove(std::uint32_t addr);
+  // remove all breakpoints
+  void Clear();
+
+  // check if there is a breakpoint at specific address
+  bool Contains(std::uint32_t addr) const {
+    if (addrs_.empty()) return false;
+    auto bit = GetFilterBit(addr);
+    if (!(filter_[bit >> 6] & (std::uint64_t(1) << (bit & 63)))) {
+      return false;
+    }
+    return std::binary_search(addrs_.begin(), addrs_.end(), addr);
+  }
+
+  // getters
+  // check if there is no breakpoint
+  bool empty() const { return addrs_.empty(); }
+  // addresses of all breakpoints (sorted)
+  const std::vector<std::uint32_t> &addrs() const { return addrs_; }
+
+ private:
+  // count of bits in filter
+  static const std::uint32_t kFilterBits = 4096;
+
+  // get index of filter bit of specific address
+  static std::uint32_t GetFilterBit(std::uint32_t addr) {
+    return (addr >> 2) & (kFilterBits - 1);
+  }
+  // rebuild filter
+  void RebuildFilter();
+
+  // sorted addresses of breakpoints
+  std::vector<std::uint32_t> addrs_;
+  // bitmap filter of addresses
+  std::uint64_t filter_[kFilterBits / 64];
+};
+
+#endif  // RISKY32_DEBUGGER_BREAKPOINT_H_
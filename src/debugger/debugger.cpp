@@ -5,6 +5,7 @@
 #include <sstream>
 #include <string>
 #include <vector>
+#include <algorithm>
 #include <cassert>
 #include <cstdlib>
 #include <cctype>
@@ -12,23 +13,23 @@
 #include "readline/readline.h"
 #include "readline/history.h"
 #include "debugger/disasm.h"
-#include "define/mmio.h"
 #include "util/style.h"
 
 namespace {
 
-// MMIO address of 'break' operation
-constexpr std::uint32_t kAddrBreak = 0x0;
-// debugger breakpoint instruction ('sw zero, 0xff0(zero)')
-constexpr std::uint32_t kBreakInst = 0xfe002823;
-static_assert(kAddrBreak == 0x0 && kMMIOAddrDebugger == 0xfffffff0);
+// interval of checkpoints for reverse execution (in cycles)
+// cost of each reverse operation is bounded by this interval
+constexpr std::uint64_t kCheckpointInterval = 1 << 16;
+// max count of checkpoints
+constexpr std::size_t kMaxCheckpoints = 256;
 
 // name of all debugger commands
 enum class CommandName {
   Unknown,
   Help, Quit,
-  Break, Watch, Delete,
+  Break, Watch, WatchMem, Delete,
   Continue, StepInst,
+  ReverseContinue, ReverseStepInst,
   Print, Examine, Disasm, Info,
 };
 
@@ -51,9 +52,14 @@ const std::unordered_map<std::string_view, CommandName> kCmdMap = {
   {"quit", CommandName::Quit}, {"q", CommandName::Quit},
   {"break", CommandName::Break}, {"b", CommandName::Break},
   {"watch", CommandName::Watch}, {"w", CommandName::Watch},
+  {"watchmem", CommandName::WatchMem}, {"wm", CommandName::WatchMem},
   {"delete", CommandName::Delete}, {"d", CommandName::Delete},
   {"continue", CommandName::Continue}, {"c", CommandName::Continue},
   {"stepi", CommandName::StepInst}, {"si", CommandName::StepInst},
+  {"reverse-continue", CommandName::ReverseContinue},
+  {"rc", CommandName::ReverseContinue},
+  {"reverse-stepi", CommandName::ReverseStepInst},
+  {"rsi", CommandName::ReverseStepInst},
   {"print", CommandName::Print}, {"p", CommandName::Print},
   {"x", CommandName::Examine},
   {"disasm", CommandName::Disasm}, {"da", CommandName::Disasm},
@@ -90,12 +96,18 @@ void PrintHelp() {
                "--- set breakpoint at ADDR" << std::endl;
   std::cout << "  watch/w   EXPR      "
                "--- set watchpoint at EXPR" << std::endl;
+  std::cout << "  watchmem/wm [r|w|a] N EXPR "
+               "--- set data watchpoint" << std::endl;
   std::cout << "  delete/d  [N]       "
                "--- delete breakpoint/watchpoint" << std::endl;
   std::cout << "  continue/c          "
                "--- continue running" << std::endl;
   std::cout << "  stepi/si  [N]       "
                "--- step by N instructions" << std::endl;
+  std::cout << "  reverse-continue/rc "
+               "--- run backward to the last stop" << std::endl;
+  std::cout << "  reverse-stepi/rsi [N] "
+               "--- step backward by N instructions" << std::endl;
   std::cout << "  print/p   [EXPR]    "
                "--- show value of EXPR" << std::endl;
   std::cout << "  x         N EXPR    "
@@ -124,6 +136,8 @@ void PrintHelp(CommandName cmd) {
       std::cout << "Syntax: break/b [ADDR]" << std::endl;
       std::cout << "  Set a breakpoint at specific address (PC), "
                    "ADDR defaults to current PC." << std::endl;
+      std::cout << "  ADDR can be an expression, including symbol names "
+                   "(e.g. 'main + 8')." << std::endl;
       break;
     }
     case CommandName::Watch: {
@@ -132,6 +146,14 @@ void PrintHelp(CommandName cmd) {
                    "pause when EXPR changes." << std::endl;
       break;
     }
+    case CommandName::WatchMem: {
+      std::cout << "Syntax: watchmem/wm [r|w|a] N EXPR" << std::endl;
+      std::cout << "  Set a data watchpoint for N bytes memory at address "
+                   "EXPR, pause when" << std::endl;
+      std::cout << "  it is read (r), written (w) or accessed (a) by "
+                   "loads/stores, defaults to 'w'." << std::endl;
+      break;
+    }
     case CommandName::Delete: {
       std::cout << "Syntax: delete/d [N]" << std::endl;
       std::cout << "  Delete breakpoint/watchpoint N, delete all "
@@ -149,6 +171,24 @@ void PrintHelp(CommandName cmd) {
                    "N defaults to 1." << std::endl;
       break;
     }
+    case CommandName::ReverseContinue: {
+      std::cout << "Syntax: reverse-continue/rc" << std::endl;
+      std::cout << "  Run backward to the last breakpoint/watchpoint "
+                   "hit before current cycle." << std::endl;
+      std::cout << "  Only the last " << kMaxCheckpoints << " * "
+                << kCheckpointInterval << " cycles can be reversed."
+                << std::endl;
+      break;
+    }
+    case CommandName::ReverseStepInst: {
+      std::cout << "Syntax: reverse-stepi/rsi [N]" << std::endl;
+      std::cout << "  Step backward by N instructions, "
+                   "N defaults to 1." << std::endl;
+      std::cout << "  Only the last " << kMaxCheckpoints << " * "
+                << kCheckpointInterval << " cycles can be reversed."
+                << std::endl;
+      break;
+    }
     case CommandName::Print: {
       std::cout << "Syntax: print/p [EXPR]" << std::endl;
       std::cout << "  Show value of EXPR, "
@@ -210,6 +250,70 @@ void Debugger::InitSignal() {
             << std::endl;
 }
 
+void Debugger::StepMachine() {
+  // take checkpoint at the beginning of every interval
+  if (!(cycle_ % kCheckpointInterval) &&
+      (checkpoints_.empty() || checkpoints_.back() != cycle_)) {
+    machine_.PushCheckpoint();
+    checkpoints_.push_back(cycle_);
+    if (checkpoints_.size() > kMaxCheckpoints) {
+      machine_.DropOldestCheckpoint();
+      checkpoints_.pop_front();
+    }
+  }
+  // run next cycle
+  machine_.NextCycle();
+  ++cycle_;
+}
+
+void Debugger::RollBack(std::uint64_t cycle) {
+  assert(!checkpoints_.empty() && cycle >= checkpoints_.front());
+  // count of checkpoints after the specific cycle
+  auto it = std::upper_bound(checkpoints_.begin(), checkpoints_.end(),
+                             cycle);
+  std::size_t n = checkpoints_.end() - it;
+  auto ret = machine_.Restore(n);
+  assert(ret);
+  static_cast<void>(ret);
+  checkpoints_.resize(checkpoints_.size() - n);
+  cycle_ = checkpoints_.back();
+}
+
+void Debugger::SeekTo(std::uint64_t cycle) {
+  if (cycle < cycle_) RollBack(cycle);
+  // re-execute, the machine is deterministic since console is replayed
+  while (cycle_ < cycle) StepMachine();
+  // marker & data watchpoints have already been handled before
+  machine_.CheckAndClearMarker();
+  data_watches_.CheckAndClearHit();
+}
+
+void Debugger::RunMachine() {
+  while (!user_pause_ && !machine_.halted() &&
+         !machine_.gpio()->marker()) {
+    // breakpoints will be reported in 'NextCycle'
+    if (cycle_ != resume_cycle_ && pc_bp_.Contains(core_.pc())) return;
+    StepMachine();
+    if (!data_watches_.empty() && CheckDataWatchpoints()) {
+      dbg_pause_ = true;
+      return;
+    }
+  }
+}
+
+bool Debugger::CheckBreakpoint() {
+  auto pc = core_.pc();
+  if (!pc_bp_.Contains(pc)) return false;
+  // update hit count
+  for (auto &&it : breaks_) {
+    if (it.second.addr == pc) ++it.second.hit_count;
+  }
+  // show message
+  std::cout << "breakpoint hit, pc = 0x" << std::hex << std::setw(8)
+            << std::setfill('0') << pc << std::dec << std::endl;
+  return true;
+}
+
 bool Debugger::CheckWatchpoints() {
   for (auto &&it : watches_) {
     // get watchpoint info
@@ -233,6 +337,37 @@ bool Debugger::CheckWatchpoints() {
   return false;
 }
 
+bool Debugger::WatchpointsChanged() {
+  for (const auto &it : watches_) {
+    std::uint32_t cur_val;
+    auto ret = expr_eval_.Eval(it.second.record_id, cur_val);
+    assert(ret);
+    static_cast<void>(ret);
+    if (cur_val != it.second.last_val) return true;
+  }
+  return false;
+}
+
+void Debugger::UpdateWatchpoints() {
+  for (auto &&it : watches_) {
+    auto ret = expr_eval_.Eval(it.second.record_id, it.second.last_val);
+    assert(ret);
+    static_cast<void>(ret);
+  }
+}
+
+bool Debugger::CheckDataWatchpoints() {
+  if (!data_watches_.CheckAndClearHit()) return false;
+  const auto &info = data_watches_.hit_watch();
+  ++data_hit_counts_[info.id];
+  // show message
+  std::cout << "data watchpoint " << info.id << " hit ("
+            << (data_watches_.hit_store() ? "write" : "read") << " at 0x"
+            << std::hex << std::setw(8) << std::setfill('0')
+            << data_watches_.hit_addr() << std::dec << ")" << std::endl;
+  return true;
+}
+
 bool Debugger::Eval(std::string_view expr, std::uint32_t &ans) {
   return Eval(expr, ans, true);
 }
@@ -248,14 +383,8 @@ bool Debugger::DeleteBreak(std::uint32_t id) {
   // try to find breakpoint info
   auto it = breaks_.find(id);
   if (it == breaks_.end()) return false;
-  const auto &info = it->second;
   // delete breakpoint
-  core_.raw_bus()->WriteWord(info.addr, info.org_inst);
-  if (cur_bp_ == &info) {
-    core_.ReExecute(info.org_inst);
-    cur_bp_ = nullptr;
-  }
-  pc_bp_.erase(info.addr);
+  pc_bp_.Remove(it->second.addr);
   breaks_.erase(it);
   return true;
 }
@@ -271,40 +400,46 @@ bool Debugger::DeleteWatch(std::uint32_t id) {
   return true;
 }
 
+bool Debugger::DeleteDataWatch(std::uint32_t id) {
+  if (!data_watches_.Remove(id)) return false;
+  data_hit_counts_.erase(id);
+  return true;
+}
+
 void Debugger::ShowDisasm() {
   auto base = core_.pc() - 2 * 4;
   ShowDisasm(base, 10);
 }
 
+void Debugger::ShowSymbolLabel(std::uint32_t addr, bool force) {
+  auto sym = machine_.symbols().Find(addr);
+  if (!sym || (!force && sym->addr != addr)) return;
+  std::cout << '<' << machine_.symbols().Symbolize(addr) << ">:"
+            << std::endl;
+}
+
 void Debugger::ShowDisasm(std::uint32_t base, std::uint32_t count) {
   assert((base & 0b11) == 0 && count);
   // get all disassembly
   std::vector<DisasmInfo> code;
-  int padding = 0;
+  std::size_t padding = 0;
   bool inc_bp = false;
   for (std::uint32_t i = 0; i < count; ++i) {
     auto addr = base + i * 4;
     // get instruction data
-    std::uint32_t inst_data;
-    bool is_bp = false;
-    for (const auto &it : breaks_) {
-      if (it.second.addr == addr) {
-        inst_data = it.second.org_inst;
-        is_bp = true;
-        break;
-      }
-    }
-    if (!is_bp) inst_data = core_.raw_bus()->ReadWord(addr);
+    auto inst_data = core_.raw_bus()->ReadWord(addr);
+    bool is_bp = pc_bp_.Contains(addr);
     // get disassembly
-    auto disasm = Disassemble(inst_data, addr);
+    auto disasm = Disassemble(inst_data, addr, &machine_.symbols());
     code.push_back({is_bp, addr, inst_data, disasm});
     // update padding width & breakpoint flag
     if (disasm.first.size() > padding) padding = disasm.first.size();
     if (!inc_bp && is_bp) inc_bp = is_bp;
   }
   // print disassembly
-  auto cur_pc = cur_bp_ ? cur_bp_->addr : core_.pc();
+  auto cur_pc = core_.pc();
   for (const auto &i : code) {
+    ShowSymbolLabel(i.addr, i.addr == base);
     // print breakpoint info
     if (inc_bp) {
       if (i.is_breakpoint) {
@@ -369,6 +504,8 @@ void Debugger::AcceptCommand() {
     // free line buffer
     std::free(line);
   }
+  // breakpoint at current PC should not be hit again
+  resume_cycle_ = cycle_;
 }
 
 bool Debugger::ParseCommand(std::istream &is) {
@@ -400,6 +537,10 @@ bool Debugger::ParseCommand(std::istream &is) {
       CreateWatch(is);
       break;
     }
+    case CommandName::WatchMem: {
+      CreateDataWatch(is);
+      break;
+    }
     case CommandName::Delete: {
       DeletePoint(is);
       break;
@@ -410,6 +551,14 @@ bool Debugger::ParseCommand(std::istream &is) {
     case CommandName::StepInst: {
       return StepByInst(is);
     }
+    case CommandName::ReverseContinue: {
+      ReverseContinue();
+      break;
+    }
+    case CommandName::ReverseStepInst: {
+      ReverseStepInst(is);
+      break;
+    }
     case CommandName::Print: {
       PrintExpr(is);
       break;
@@ -452,17 +601,12 @@ void Debugger::CreateBreak(std::istream &is) {
     return;
   }
   // check for duplicates
-  if (pc_bp_.find(addr) != pc_bp_.end()) {
+  if (!pc_bp_.Add(addr)) {
     LogError("there is already a breakpoint at specific address");
     return;
   }
-  // replace original instruction
-  auto org_inst = core_.raw_bus()->ReadWord(addr);
-  core_.raw_bus()->WriteWord(addr, kBreakInst);
   // store breakpoint info
-  auto ret = breaks_.insert({next_id_++, {addr, org_inst, 0}});
-  assert(ret.second);
-  pc_bp_.insert({addr, &ret.first->second});
+  breaks_.insert({next_id_++, {addr, 0}});
 }
 
 void Debugger::CreateWatch(std::istream &is) {
@@ -479,6 +623,34 @@ void Debugger::CreateWatch(std::istream &is) {
   watches_.insert({next_id_++, {id, value, 0}});
 }
 
+void Debugger::CreateDataWatch(std::istream &is) {
+  // get kind of watchpoint
+  auto kind = WatchpointSet::kWrite;
+  is >> std::ws;
+  switch (is.peek()) {
+    case 'r': kind = WatchpointSet::kRead; is.get(); break;
+    case 'w': kind = WatchpointSet::kWrite; is.get(); break;
+    case 'a': kind = WatchpointSet::kAccess; is.get(); break;
+    default:;
+  }
+  // get parameters
+  std::uint32_t addr, n;
+  std::string expr;
+  is >> n;
+  if (!is || !n) {
+    LogError("invalid count 'N', try 'help watchmem'");
+    return;
+  }
+  if (!std::getline(is, expr)) {
+    LogError("invalid 'EXPR', try 'help watchmem'");
+    return;
+  }
+  if (!Eval(expr, addr, false)) return;
+  // store watchpoint info
+  data_watches_.Add(next_id_, addr, n, kind);
+  data_hit_counts_[next_id_++] = 0;
+}
+
 void Debugger::DeletePoint(std::istream &is) {
   if (is.eof()) {
     // show confirm message
@@ -493,6 +665,8 @@ void Debugger::DeletePoint(std::istream &is) {
     // delete all watchpoints
     auto watches = watches_;
     for (const auto &i : watches) DeleteWatch(i.first);
+    data_watches_.Clear();
+    data_hit_counts_.clear();
   }
   else {
     // get id from input
@@ -503,7 +677,7 @@ void Debugger::DeletePoint(std::istream &is) {
       return;
     }
     // delete point by id
-    if (!DeleteBreak(n) && !DeleteWatch(n)) {
+    if (!DeleteBreak(n) && !DeleteWatch(n) && !DeleteDataWatch(n)) {
       LogError("breakpoint/watchpoint not found");
     }
   }
@@ -526,6 +700,75 @@ bool Debugger::StepByInst(std::istream &is) {
   return true;
 }
 
+void Debugger::ReverseStepInst(std::istream &is) {
+  // get step count
+  int count = 1;
+  if (!is.eof()) {
+    is >> count;
+    if (!is || count <= 0) {
+      LogError("invalid step count");
+      return;
+    }
+  }
+  if (checkpoints_.empty() || cycle_ == checkpoints_.front()) {
+    LogError("no more reverse execution history");
+    return;
+  }
+  // step backward
+  auto target = cycle_ - checkpoints_.front();
+  if (target < static_cast<std::uint64_t>(count)) {
+    std::cout << "reached the beginning of reverse execution history"
+              << std::endl;
+    target = checkpoints_.front();
+  }
+  else {
+    target = cycle_ - count;
+  }
+  SeekTo(target);
+  UpdateWatchpoints();
+  std::cout << std::endl;
+  ShowDisasm();
+}
+
+void Debugger::ReverseContinue() {
+  if (checkpoints_.empty() || cycle_ == checkpoints_.front()) {
+    LogError("no more reverse execution history");
+    return;
+  }
+  // search backward interval by interval, re-execute each interval
+  // and find the last breakpoint/watchpoint hit in it
+  auto cur = cycle_, end = cycle_, found = cycle_;
+  while (found == cur && end > checkpoints_.front()) {
+    RollBack(end - 1);
+    auto begin = cycle_;
+    UpdateWatchpoints();
+    while (cycle_ < end) {
+      if (pc_bp_.Contains(core_.pc())) found = cycle_;
+      StepMachine();
+      if (data_watches_.CheckAndClearHit() && cycle_ < cur) found = cycle_;
+      if (cycle_ < cur && !watches_.empty() && WatchpointsChanged()) {
+        found = cycle_;
+        UpdateWatchpoints();
+      }
+    }
+    end = begin;
+  }
+  // move to the position of hit
+  if (found == cur) {
+    std::cout << "reached the beginning of reverse execution history"
+              << std::endl;
+    found = end;
+  }
+  else {
+    std::cout << "breakpoint/watchpoint hit, reversed "
+              << cur - found << " cycle(s)" << std::endl;
+  }
+  SeekTo(found);
+  UpdateWatchpoints();
+  std::cout << std::endl;
+  ShowDisasm();
+}
+
 void Debugger::PrintExpr(std::istream &is) {
   std::uint32_t value, id;
   // get expression
@@ -566,7 +809,8 @@ void Debugger::ExamineMem(std::istream &is) {
   }
   if (!Eval(expr, addr, false)) return;
   // print memory units
-  while (n--) {
+  for (auto base = addr; n--;) {
+    ShowSymbolLabel(addr, addr == base);
     std::cout << std::hex << std::setfill('0') << std::setw(8) << addr;
     std::cout << ": " << std::setw(2) << std::setfill('0')
               << static_cast<int>(core_.raw_bus()->ReadByte(addr++)) << ' ';
@@ -648,11 +892,12 @@ void Debugger::PrintInfo(std::istream &is) {
     }
     case InfoItem::Watch: {
       // watchpoint info
-      if (watches_.empty()) {
+      if (watches_.empty() && data_watches_.empty()) {
         std::cout << "no watchpoints currently set" << std::endl;
       }
       else {
-        std::cout << "number of watchpoints: " << watches_.size()
+        std::cout << "number of watchpoints: "
+                  << watches_.size() + data_watches_.watches().size()
                   << std::endl;
         for (const auto &it : watches_) {
           const auto &info = it.second;
@@ -662,6 +907,14 @@ void Debugger::PrintInfo(std::istream &is) {
           std::cout << "', value = " << info.last_val
                     << ", hit_count = " << info.hit_count << std::endl;
         }
+        for (const auto &info : data_watches_.watches()) {
+          std::cout << "  data watchpoint #" << info.id << ": "
+                    << "rwa"[info.kind - 1] << " 0x" << std::hex
+                    << std::setw(8) << std::setfill('0') << info.addr
+                    << std::dec << ", len = " << info.len
+                    << ", hit_count = " << data_hit_counts_[info.id]
+                    << std::endl;
+        }
       }
       break;
     }
@@ -669,43 +922,11 @@ void Debugger::PrintInfo(std::istream &is) {
   }
 }
 
-std::uint8_t Debugger::ReadByte(std::uint32_t addr) {
-  return 0;
-}
-
-void Debugger::WriteByte(std::uint32_t addr, std::uint8_t value) {
-  // do nothing
-}
-
-std::uint16_t Debugger::ReadHalf(std::uint32_t addr) {
-  return 0;
-}
-
-void Debugger::WriteHalf(std::uint32_t addr, std::uint16_t value) {
-  // do nothing
-}
-
-std::uint32_t Debugger::ReadWord(std::uint32_t addr) {
-  return 0;
-}
-
-void Debugger::WriteWord(std::uint32_t addr, std::uint32_t value) {
-  if (addr == kAddrBreak) {
-    // breakpoint triggered
+void Debugger::NextCycle() {
+  // check breakpoints (except the one debugger just resumed from)
+  if (cycle_ != resume_cycle_ && CheckBreakpoint()) {
     dbg_pause_ = true;
-    // update current breakpoint info
-    auto it = pc_bp_.find(core_.pc());
-    assert(it != pc_bp_.end());
-    cur_bp_ = it->second;
-    // update hit count
-    ++it->second->hit_count;
-    // show message
-    std::cout << "breakpoint hit, pc = 0x" << std::hex << std::setw(8)
-              << std::setfill('0') << it->first << std::dec << std::endl;
   }
-}
-
-void Debugger::NextCycle() {
   // check user interrupt or breakpoints
   if (user_pause_ || dbg_pause_) AcceptCommand();
   // check watchpoints
@@ -713,12 +934,10 @@ void Debugger::NextCycle() {
   // check/update step count
   if (!step_count_) AcceptCommand();
   if (step_count_ > 0) --step_count_;
-  // run next core cycle
-  if (cur_bp_) {
-    core_.ReExecute(cur_bp_->org_inst);
-    cur_bp_ = nullptr;
-  }
-  else {
-    core_.NextCycle();
-  }
+  // nothing to check per cycle when continuing, run in a tight loop
+  if (step_count_ < 0 && watches_.empty()) return RunMachine();
+  // run next cycle of machine
+  StepMachine();
+  // check data watchpoints, pause before the next cycle if hit
+  if (!data_watches_.empty() && CheckDataWatchpoints()) dbg_pause_ = true;
 }
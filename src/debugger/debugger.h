@@ -5,31 +5,31 @@
 #include <string_view>
 #include <istream>
 #include <unordered_map>
+#include <deque>
 #include <cstdint>
 
 #include <signal.h>
 
 #include "core/core.h"
-#include "peripheral/storage/rom.h"
-#include "peripheral/peripheral.h"
+#include "machine/machine.h"
+#include "bus/watchpoint.h"
+#include "debugger/breakpoint.h"
 #include "debugger/expreval.h"
 
-class Debugger : public PeripheralInterface {
+class Debugger {
  public:
-  Debugger(Core &core)
-      : core_(core), expr_eval_(core), prompt_("risky32> "),
-        dbg_pause_(false), step_count_(-1), next_id_(0), cur_bp_(nullptr) {
+  Debugger(Machine &machine)
+      : machine_(machine), core_(machine.core()),
+        expr_eval_(machine.core(), machine.symbols()),
+        prompt_("risky32> "),
+        dbg_pause_(false), step_count_(-1), next_id_(0), cycle_(0),
+        resume_cycle_(0) {
     InitSignal();
+    // console must be replayable for reverse execution
+    machine_.gpio()->set_keep_history(true);
+    core_.set_watches(&data_watches_);
   }
 
-  std::uint8_t ReadByte(std::uint32_t addr) override;
-  void WriteByte(std::uint32_t addr, std::uint8_t value) override;
-  std::uint16_t ReadHalf(std::uint32_t addr) override;
-  void WriteHalf(std::uint32_t addr, std::uint16_t value) override;
-  std::uint32_t ReadWord(std::uint32_t addr) override;
-  void WriteWord(std::uint32_t addr, std::uint32_t value) override;
-  std::uint32_t size() const override { return 16; }
-
   // emulate next cycle
   void NextCycle();
 
@@ -41,8 +41,6 @@ class Debugger : public PeripheralInterface {
   struct BreakInfo {
     // PC address of breakpoint
     std::uint32_t addr;
-    // original instruction at PC address
-    std::uint32_t org_inst;
     // hit count
     std::uint32_t hit_count;
   };
@@ -61,8 +59,25 @@ class Debugger : public PeripheralInterface {
   static void SignalHandler(int sig);
   // initialize signal handler
   void InitSignal();
+  // run next cycle of machine, and take checkpoints periodically
+  void StepMachine();
+  // run machine until a breakpoint/data watchpoint is hit, guest halts,
+  // writes the marker or user pauses
+  void RunMachine();
+  // roll back to the latest checkpoint not after specific cycle
+  void RollBack(std::uint64_t cycle);
+  // roll back and re-execute to specific cycle in the history
+  void SeekTo(std::uint64_t cycle);
+  // check if there is a breakpoint at current PC
+  bool CheckBreakpoint();
   // check if there are any watchpoints hit
   bool CheckWatchpoints();
+  // check if any watchpoints have changed, without updating them
+  bool WatchpointsChanged();
+  // update last value of all watchpoints
+  void UpdateWatchpoints();
+  // check if there are any data watchpoints hit
+  bool CheckDataWatchpoints();
   // evaluate expression with record
   bool Eval(std::string_view expr, std::uint32_t &ans);
   // evaluate expression
@@ -71,10 +86,15 @@ class Debugger : public PeripheralInterface {
   bool DeleteBreak(std::uint32_t id);
   // delete watchpoint by id, returns false if failed
   bool DeleteWatch(std::uint32_t id);
+  // delete data watchpoint by id, returns false if failed
+  bool DeleteDataWatch(std::uint32_t id);
   // show disassembly near current PC
   void ShowDisasm();
   // show disassembly
   void ShowDisasm(std::uint32_t base, std::uint32_t count);
+  // show label of symbol if address is the start of a symbol,
+  // or 'force' is true and address is inside a symbol
+  void ShowSymbolLabel(std::uint32_t addr, bool force);
 
   // accept user input
   void AcceptCommand();
@@ -84,10 +104,17 @@ class Debugger : public PeripheralInterface {
   void CreateBreak(std::istream &is);
   // create a new watchpoint ('watch EXPR' command)
   void CreateWatch(std::istream &is);
+  // create a new data watchpoint ('watchmem [r|w|a] N EXPR' command)
+  void CreateDataWatch(std::istream &is);
   // delete breakpoint/watchpoint ('delete [N]' command)
   void DeletePoint(std::istream &is);
   // step by machine instructions ('stepi [N]' command)
   bool StepByInst(std::istream &is);
+  // step backward by machine instructions ('reverse-stepi [N]' command)
+  void ReverseStepInst(std::istream &is);
+  // run backward to the last breakpoint/watchpoint hit
+  // ('reverse-continue' command)
+  void ReverseContinue();
   // print value of expression ('print EXPR' command)
   void PrintExpr(std::istream &is);
   // examine memory ('x N EXPR' command)
@@ -102,7 +129,8 @@ class Debugger : public PeripheralInterface {
   // pointer of sigaction
   std::unique_ptr<struct sigaction> sig_;
 
-  // reference of emulation core
+  // reference of machine & emulation core
+  Machine &machine_;
   Core &core_;
 
   // evaluator
@@ -116,14 +144,23 @@ class Debugger : public PeripheralInterface {
 
   // breakpoint list
   std::unordered_map<std::uint32_t, BreakInfo> breaks_;
-  // hashmap of pc address to breakpoint info reference
-  std::unordered_map<std::uint32_t, BreakInfo *> pc_bp_;
+  // addresses of all breakpoints
+  BreakpointSet pc_bp_;
   // watchpoint list
   std::unordered_map<std::uint32_t, WatchInfo> watches_;
+  // data watchpoints (checked on loads & stores)
+  WatchpointSet data_watches_;
+  // hit count of data watchpoints
+  std::unordered_map<std::uint32_t, std::uint32_t> data_hit_counts_;
   // next breakpoint/watchpoint id
   std::uint32_t next_id_;
-  // current breakpoint info reference (used to re-execute)
-  BreakInfo *cur_bp_;
+
+  // count of executed cycles
+  std::uint64_t cycle_;
+  // cycle at which debugger resumed running
+  std::uint64_t resume_cycle_;
+  // cycles of all checkpoints (kept in machine) for reverse execution
+  std::deque<std::uint64_t> checkpoints_;
 };
 
 #endif  // RISKY32_DEBUGGER_DEBUGGER_H_
@@ -3,11 +3,27 @@
 
 #include <string>
 #include <utility>
+#include <cstddef>
 #include <cstdint>
 
+#include "util/symtab.h"
+#include "util/textwriter.h"
+
 using Disasm = std::pair<std::string, std::string>;
 
+// max length of disassembled instruction, excluding length of
+// symbol names in symbolized targets
+constexpr std::size_t kMaxDisasmLen = 80;
+
 // get disassembled instruction data
-Disasm Disassemble(std::uint32_t inst_data, std::uint32_t addr);
+// jump/branch targets will be symbolized if 'symbols' is not null
+Disasm Disassemble(std::uint32_t inst_data, std::uint32_t addr,
+                   const SymbolTable *symbols = nullptr);
+
+// write disassembled instruction to text writer without any allocation
+// opcode and arguments are separated by '\t'
+void DisassembleTo(TextWriter &w, std::uint32_t inst_data,
+                   std::uint32_t addr,
+                   const SymbolTable *symbols = nullptr);
 
 #endif  // RISKY32_DEBUGGER_DISASM_H_
@@ -3,7 +3,6 @@
 #include <iostream>
 #include <iomanip>
 #include <stack>
-#include <utility>
 #include <algorithm>
 #include <cassert>
 #include <cctype>
@@ -19,7 +18,7 @@ EBNF of expressions:
 
 binary  ::= unary bin_op unray
 unary   ::= una_op value
-value   ::= NUM | REG_NAME | '(' binary ')'
+value   ::= NUM | REG_NAME | SYMBOL | '(' binary ')'
 
 */
 
@@ -108,6 +107,9 @@ constexpr int kOpPrec[] = {
   70, 70, 70, 70,
 };
 
+// max depth of stack when evaluating expressions
+constexpr std::size_t kMaxStackDepth = 64;
+
 // check if specific character can appear in operators
 inline bool IsOperatorChar(char c) {
   assert(c);
@@ -118,6 +120,11 @@ inline bool IsOperatorChar(char c) {
   return false;
 }
 
+// check if specific character can appear in symbol names
+inline bool IsSymbolChar(char c) {
+  return std::isalpha(c) || c == '_' || c == '.';
+}
+
 }  // namespace
 
 ExprEvaluator::Token ExprEvaluator::NextToken() {
@@ -129,6 +136,8 @@ ExprEvaluator::Token ExprEvaluator::NextToken() {
   if (std::isdigit(last_char_)) return HandleNum();
   // register name or value reference
   if (last_char_ == '$') return HandleRegRef();
+  // symbol name
+  if (IsSymbolChar(last_char_)) return HandleSymbol();
   // operator
   if (IsOperatorChar(last_char_)) return HandleOperator();
   // other characters
@@ -203,6 +212,21 @@ ExprEvaluator::Token ExprEvaluator::HandleRegRef() {
   }
 }
 
+ExprEvaluator::Token ExprEvaluator::HandleSymbol() {
+  std::string name;
+  // get symbol name
+  while (!iss_.eof() && (IsSymbolChar(last_char_) ||
+                         std::isdigit(last_char_))) {
+    name += last_char_;
+    NextChar();
+  }
+  // get address of symbol
+  if (!symbols_.GetAddr(name, num_val_)) {
+    return LogLexerError("unknown symbol");
+  }
+  return cur_token_ = Token::Num;
+}
+
 ExprEvaluator::Token ExprEvaluator::HandleOperator() {
   std::string op;
   // get operator string
@@ -211,7 +235,7 @@ ExprEvaluator::Token ExprEvaluator::HandleOperator() {
     NextChar();
   } while (!iss_.eof() && IsOperatorChar(last_char_));
   // check is a valid operator
-  for (int i = 0; i < sizeof(kOpList) / sizeof(std::string_view); ++i) {
+  for (std::size_t i = 0; i < sizeof(kOpList) / sizeof(std::string_view); ++i) {
     if (kOpList[i] == op) {
       op_val_ = static_cast<Operator>(i);
       return cur_token_ = Token::Operator;
@@ -220,20 +244,17 @@ ExprEvaluator::Token ExprEvaluator::HandleOperator() {
   return LogLexerError("invalid operator");
 }
 
-bool ExprEvaluator::Parse(std::uint32_t &ans) {
+bool ExprEvaluator::Parse() {
   if (cur_token_ == Token::End) return false;
-  if (!ParseBinary(ans)) return false;
+  if (!ParseBinary()) return false;
   return cur_token_ == Token::End;
 }
 
-bool ExprEvaluator::ParseBinary(std::uint32_t &ans) {
-  std::stack<std::uint32_t> oprs;
+bool ExprEvaluator::ParseBinary() {
   std::stack<Operator> ops;
-  std::uint32_t val;
   // get the first value
-  if (!ParseUnary(val)) return false;
-  oprs.push(val);
-  // calculate using stack
+  if (!ParseUnary()) return false;
+  // generate instructions in postfix order using stack
   while (cur_token_ == Token::Operator) {
     // get operator
     auto op = op_val_;
@@ -241,93 +262,73 @@ bool ExprEvaluator::ParseBinary(std::uint32_t &ans) {
     NextToken();
     // handle operator
     while (!ops.empty() && GetOpPrec(ops.top()) >= GetOpPrec(op)) {
-      // get current operator & operand
-      auto cur_op = ops.top();
+      code_.push_back({OpCode::Binary,
+                       static_cast<std::uint32_t>(ops.top()), nullptr});
       ops.pop();
-      auto rhs = oprs.top();
-      oprs.pop();
-      auto lhs = oprs.top();
-      oprs.pop();
-      // calculate
-      oprs.push(CalcByOperator(cur_op, lhs, rhs));
     }
     // push & get next value
     ops.push(op);
-    if (!ParseUnary(val)) return false;
-    oprs.push(val);
+    if (!ParseUnary()) return false;
   }
-  // clear stacks
+  // clear stack
   while (!ops.empty()) {
-    auto cur_op = ops.top();
+    code_.push_back({OpCode::Binary,
+                     static_cast<std::uint32_t>(ops.top()), nullptr});
     ops.pop();
-    auto rhs = oprs.top();
-    oprs.pop();
-    auto lhs = oprs.top();
-    oprs.pop();
-    oprs.push(CalcByOperator(cur_op, lhs, rhs));
   }
-  ans = oprs.top();
   return true;
 }
 
-bool ExprEvaluator::ParseUnary(std::uint32_t &ans) {
+bool ExprEvaluator::ParseUnary() {
   // check if need to get operator
   if (cur_token_ == Token::Operator) {
     auto op = op_val_;
     NextToken();
     // get operand
-    std::uint32_t operand;
-    if (!ParseUnary(operand)) return false;
-    // calculate
+    if (!ParseUnary()) return false;
+    // generate instruction
     switch (op) {
-      case Operator::Add: ans = operand; break;
-      case Operator::Sub: ans = -operand; break;
-      case Operator::LogicNot: ans = !operand; break;
-      case Operator::Not: ans = ~operand; break;
-      case Operator::Mul: {
-        if (operand & 0b11) return LogParserError("address misaligned");
-        ans = core_.raw_bus()->ReadWord(operand);
+      case Operator::Add: break;
+      case Operator::Sub: code_.push_back({OpCode::Neg, 0, nullptr}); break;
+      case Operator::LogicNot: {
+        code_.push_back({OpCode::LogicNot, 0, nullptr});
         break;
       }
+      case Operator::Not: code_.push_back({OpCode::Not, 0, nullptr}); break;
+      case Operator::Mul: code_.push_back({OpCode::Load, 0, nullptr}); break;
       default: return LogParserError("invalid unary operator");
     }
     return true;
   }
   else {
-    return ParseValue(ans);
+    return ParseValue();
   }
 }
 
-bool ExprEvaluator::ParseValue(std::uint32_t &ans) {
+bool ExprEvaluator::ParseValue() {
   switch (cur_token_) {
     case Token::Num: {
       // just number
-      ans = num_val_;
+      code_.push_back({OpCode::Num, num_val_, nullptr});
       break;
     }
     case Token::RegName: {
-      // get GPR/CSR value from core
+      // GPR/CSR of core, CSR is resolved to pointer of its data
       // '<= 32' makes sence because U-mode trap is not supported
       if (num_val_ <= 32) {
-        ans = core_.regs(num_val_);
+        code_.push_back({OpCode::Reg, num_val_, nullptr});
       }
       else {
-        ans = core_.csr().ReadDataForce(num_val_);
+        auto ptr = core_.csr().GetDataPtr(num_val_);
+        assert(ptr);
+        code_.push_back({OpCode::CSR, 0, ptr});
       }
       break;
     }
     case Token::ValRef: {
-      // store current state
-      auto iss = std::move(iss_);
-      auto last_char = last_char_;
-      auto cur_token = cur_token_;
-      // evaluate record
-      auto ret = Eval(num_val_, ans);
-      assert(ret);
-      // restore current state
-      iss_ = std::move(iss);
-      last_char_ = last_char;
-      cur_token_ = cur_token;
+      // inline instructions of record
+      const auto &code = records_.find(num_val_)->second.code;
+      code_.insert(code_.end(), code.begin(), code.end());
       break;
     }
     case Token::Char: {
@@ -335,7 +336,7 @@ bool ExprEvaluator::ParseValue(std::uint32_t &ans) {
       if (char_val_ != '(') return LogParserError("expected '('");
       NextToken();
       // parse inner binary expression
-      if (!ParseBinary(ans)) return false;
+      if (!ParseBinary()) return false;
       // check ')'
       if (cur_token_ != Token::Char || char_val_ != ')') {
         return LogParserError("expected ')'");
@@ -348,6 +349,61 @@ bool ExprEvaluator::ParseValue(std::uint32_t &ans) {
   return true;
 }
 
+bool ExprEvaluator::Compile(std::string_view expr) {
+  // reset string stream
+  iss_.str({expr.data(), expr.size()});
+  iss_.clear();
+  last_char_ = ' ';
+  code_.clear();
+  // call lexer & parser
+  NextToken();
+  if (!Parse()) return false;
+  // check depth of stack
+  std::size_t depth = 0, max_depth = 0;
+  for (const auto &i : code_) {
+    if (i.opcode <= OpCode::CSR) {
+      if (++depth > max_depth) max_depth = depth;
+    }
+    else if (i.opcode == OpCode::Binary) {
+      --depth;
+    }
+  }
+  if (max_depth > kMaxStackDepth) {
+    return LogParserError("expression is too complex");
+  }
+  return true;
+}
+
+bool ExprEvaluator::Run(const std::vector<Inst> &code,
+                        std::uint32_t &ans) {
+  std::uint32_t stack[kMaxStackDepth], *sp = stack;
+  for (const auto &i : code) {
+    switch (i.opcode) {
+      case OpCode::Num: *sp++ = i.value; break;
+      case OpCode::Reg: *sp++ = core_.regs(i.value); break;
+      case OpCode::CSR: *sp++ = *i.ptr; break;
+      case OpCode::Load: {
+        if (sp[-1] & 0b11) return LogParserError("address misaligned");
+        sp[-1] = core_.raw_bus()->ReadWord(sp[-1]);
+        break;
+      }
+      case OpCode::Neg: sp[-1] = -sp[-1]; break;
+      case OpCode::Not: sp[-1] = ~sp[-1]; break;
+      case OpCode::LogicNot: sp[-1] = !sp[-1]; break;
+      case OpCode::Binary: {
+        --sp;
+        sp[-1] = CalcByOperator(static_cast<Operator>(i.value), sp[-1],
+                                sp[0]);
+        break;
+      }
+      default: assert(false);
+    }
+  }
+  assert(sp == stack + 1);
+  ans = stack[0];
+  return true;
+}
+
 std::uint32_t ExprEvaluator::GetOpPrec(Operator op) {
   return kOpPrec[static_cast<int>(op)];
 }
@@ -392,13 +448,8 @@ bool ExprEvaluator::Eval(std::string_view expr, std::uint32_t &ans) {
 
 bool ExprEvaluator::Eval(std::string_view expr, std::uint32_t &ans,
                          bool record) {
-  // reset string stream
-  iss_.str({expr.data(), expr.size()});
-  iss_.clear();
-  last_char_ = ' ';
-  // call lexer & parser
-  NextToken();
-  if (!Parse(ans)) return false;
+  // compile & run
+  if (!Compile(expr) || !Run(code_, ans)) return false;
   // record expression
   if (record) {
     // trim expression string
@@ -406,7 +457,7 @@ bool ExprEvaluator::Eval(std::string_view expr, std::uint32_t &ans,
     auto pos = expr.find_last_not_of(" ");
     if (pos != expr.npos) expr.remove_suffix(expr.size() - pos - 1);
     // store to record
-    records_.insert({next_id_++, {expr.data(), expr.size()}});
+    records_.insert({next_id_++, {{expr.data(), expr.size()}, code_}});
   }
   return true;
 }
@@ -414,7 +465,7 @@ bool ExprEvaluator::Eval(std::string_view expr, std::uint32_t &ans,
 bool ExprEvaluator::Eval(std::uint32_t id, std::uint32_t &ans) {
   auto it = records_.find(id);
   if (it == records_.end()) return false;
-  return Eval(it->second, ans, false);
+  return Run(it->second.code, ans);
 }
 
 void ExprEvaluator::PrintRegInfo(std::ostream &os) {
@@ -468,7 +519,7 @@ void ExprEvaluator::PrintCSRInfo(std::ostream &os) {
 void ExprEvaluator::PrintExpr(std::ostream &os, std::uint32_t id) {
   auto it = records_.find(id);
   assert(it != records_.end());
-  os << it->second;
+  os << it->second.expr;
 }
 
 void ExprEvaluator::RemoveRecord(std::uint32_t id) {
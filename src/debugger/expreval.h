@@ -6,14 +6,17 @@
 #include <unordered_map>
 #include <string>
 #include <sstream>
+#include <vector>
 #include <cstdint>
 
 #include "core/core.h"
+#include "util/symtab.h"
 
 // expression evaluator
 class ExprEvaluator {
  public:
-  ExprEvaluator(Core &core) : core_(core), next_id_(0) {}
+  ExprEvaluator(Core &core, const SymbolTable &symbols)
+      : core_(core), symbols_(symbols), next_id_(0) {}
 
   // evaluate expression with record
   bool Eval(std::string_view expr, std::uint32_t &ans);
@@ -52,18 +55,51 @@ class ExprEvaluator {
     LessThan, LessEqual, GreaterThan, GreaterEqual,
   };
 
+  // opcode of compiled expressions
+  enum class OpCode : std::uint8_t {
+    // push operand to stack
+    Num, Reg, CSR,
+    // unary operations on top of stack
+    Load, Neg, Not, LogicNot,
+    // binary operation on top two values of stack
+    Binary,
+  };
+
+  // instruction of compiled expressions (stack machine)
+  struct Inst {
+    OpCode opcode;
+    // number, register address or binary operator
+    std::uint32_t value;
+    // pointer to data of CSR
+    const std::uint32_t *ptr;
+  };
+
+  // recorded expression
+  struct Record {
+    // expression string
+    std::string expr;
+    // compiled instructions (in postfix order)
+    std::vector<Inst> code;
+  };
+
   // lexer
   void NextChar() { iss_ >> last_char_; }
   Token NextToken();
   Token HandleNum();
   Token HandleRegRef();
+  Token HandleSymbol();
   Token HandleOperator();
 
-  // parser
-  bool Parse(std::uint32_t &ans);
-  bool ParseBinary(std::uint32_t &ans);
-  bool ParseUnary(std::uint32_t &ans);
-  bool ParseValue(std::uint32_t &ans);
+  // parser (generates instructions to 'code_')
+  bool Parse();
+  bool ParseBinary();
+  bool ParseUnary();
+  bool ParseValue();
+
+  // compile expression to 'code_', returns false if failed
+  bool Compile(std::string_view expr);
+  // run compiled instructions, returns false if failed
+  bool Run(const std::vector<Inst> &code, std::uint32_t &ans);
 
   // helper functions
   Token LogLexerError(std::string_view msg);
@@ -74,8 +110,10 @@ class ExprEvaluator {
 
   // reference of emulation core
   Core &core_;
+  // symbol table of guest program
+  const SymbolTable &symbols_;
   // all stored records
-  std::unordered_map<std::uint32_t, std::string> records_;
+  std::unordered_map<std::uint32_t, Record> records_;
   // next record id
   std::uint32_t next_id_;
 
@@ -92,6 +130,8 @@ class ExprEvaluator {
 
   // current token
   Token cur_token_;
+  // instructions of current expression
+  std::vector<Inst> code_;
 };
 
 #endif  // RISKY32_DEBUGGER_EXPREVAL_H_
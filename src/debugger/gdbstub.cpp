@@ -0,0 +1,545 @@
+#include "debugger/gdbstub.h"
+
+#include <string>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+
+#include <signal.h>
+#include <poll.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+// interval of polling interrupt requests (in cycles, minus 1)
+constexpr std::uint32_t kPollMask = 0xffff;
+// interrupt request of GDB (C-c)
+constexpr char kInterruptReq = 0x03;
+// max size of packet
+constexpr std::size_t kPacketSize = 0x1000;
+// count of general purpose registers (including PC)
+constexpr std::size_t kRegCount = 33;
+
+// name of all registers
+constexpr const char *kRegNames[kRegCount] = {
+  "zero", "ra", "sp", "gp", "tp", "t0", "t1", "t2",
+  "fp", "s1", "a0", "a1", "a2", "a3", "a4", "a5",
+  "a6", "a7", "s2", "s3", "s4", "s5", "s6", "s7",
+  "s8", "s9", "s10", "s11", "t3", "t4", "t5", "t6",
+  "pc",
+};
+
+const char kHexDigits[] = "0123456789abcdef";
+
+// convert hex digit to integer, returns -1 if invalid
+inline int HexToInt(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+// parse hex number and remove it from string, returns false if failed
+bool ParseHex(std::string_view &str, std::uint32_t &value) {
+  std::size_t i = 0;
+  value = 0;
+  for (; i < str.size(); ++i) {
+    auto digit = HexToInt(str[i]);
+    if (digit < 0) break;
+    value = (value << 4) | digit;
+  }
+  str.remove_prefix(i);
+  return i;
+}
+
+// parse a separator and remove it from string, returns false if failed
+bool ParseSep(std::string_view &str, char sep) {
+  if (str.empty() || str.front() != sep) return false;
+  str.remove_prefix(1);
+  return true;
+}
+
+// parse a byte in hex and remove it from string
+bool ParseByte(std::string_view &str, std::uint8_t &value) {
+  if (str.size() < 2) return false;
+  auto hi = HexToInt(str[0]), lo = HexToInt(str[1]);
+  if (hi < 0 || lo < 0) return false;
+  value = (hi << 4) | lo;
+  str.remove_prefix(2);
+  return true;
+}
+
+// parse a register value (little endian) and remove it from string
+bool ParseReg(std::string_view &str, std::uint32_t &value) {
+  value = 0;
+  for (int i = 0; i < 4; ++i) {
+    std::uint8_t byte;
+    if (!ParseByte(str, byte)) return false;
+    value |= byte << (i * 8);
+  }
+  return true;
+}
+
+// append a byte in hex to string
+inline void AppendByte(std::string &str, std::uint8_t value) {
+  str += kHexDigits[value >> 4];
+  str += kHexDigits[value & 0xf];
+}
+
+// append a register value (little endian) to string
+inline void AppendReg(std::string &str, std::uint32_t value) {
+  for (int i = 0; i < 4; ++i) AppendByte(str, value >> (i * 8));
+}
+
+// get target description
+const std::string &GetTargetDesc() {
+  static std::string desc;
+  if (desc.empty()) {
+    desc = "<?xml version=\"1.0\"?>"
+           "<!DOCTYPE target SYSTEM \"gdb-target.dtd\">"
+           "<target version=\"1.0\">"
+           "<architecture>riscv:rv32</architecture>"
+           "<feature name=\"org.gnu.gdb.riscv.cpu\">";
+    for (std::size_t i = 0; i < kRegCount; ++i) {
+      const char *type = i == 1 || i == 32 ? "code_ptr"
+                         : i == 2          ? "data_ptr"
+                                           : "int";
+      desc += "<reg name=\"";
+      desc += kRegNames[i];
+      desc += "\" bitsize=\"32\" type=\"";
+      desc += type;
+      desc += "\" regnum=\"" + std::to_string(i) + "\"/>";
+    }
+    desc += "</feature></target>";
+  }
+  return desc;
+}
+
+}  // namespace
+
+GDBStub::~GDBStub() {
+  Disconnect();
+  if (listen_fd_ >= 0) close(listen_fd_);
+  if (null_input_) std::fclose(null_input_);
+}
+
+bool GDBStub::Connect(std::string_view port) {
+  // GDB may close connection at any time
+  signal(SIGPIPE, SIG_IGN);
+  core_.set_watches(&watches_);
+  if (port == "-") {
+    // stdin is used by GDB, guest reads nothing from console
+    null_input_ = std::fopen("/dev/null", "r");
+    if (!null_input_) return false;
+    machine_.gpio()->set_input(null_input_);
+    in_fd_ = STDIN_FILENO;
+    out_fd_ = STDOUT_FILENO;
+    return true;
+  }
+  // get port number
+  std::string_view str = port;
+  std::uint32_t num = 0;
+  for (auto c : str) {
+    if (c < '0' || c > '9' || (num = num * 10 + c - '0') > 65535) {
+      return false;
+    }
+  }
+  if (str.empty()) return false;
+  // create socket
+  listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+  if (listen_fd_ < 0) return false;
+  int opt = 1;
+  setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(num);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (bind(listen_fd_, reinterpret_cast<sockaddr *>(&addr),
+           sizeof(addr)) < 0 ||
+      listen(listen_fd_, 1) < 0) {
+    return false;
+  }
+  // wait for GDB
+  int fd;
+  while ((fd = accept(listen_fd_, nullptr, nullptr)) < 0) {
+    if (errno != EINTR) return false;
+  }
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+  close(listen_fd_);
+  listen_fd_ = -1;
+  in_fd_ = out_fd_ = fd;
+  return true;
+}
+
+bool GDBStub::Run() {
+  for (;;) {
+    if (killed_) return false;
+    // GDB has detached, just run the machine
+    if (!connected()) {
+      machine_.Run();
+      return true;
+    }
+    // wait for GDB to resume the machine
+    if (!running_) {
+      HandlePackets();
+      continue;
+    }
+    // run until stopped
+    auto reason = RunMachine();
+    // exit code will be reported when finished
+    if (machine_.halted()) return true;
+    if (reason != StopReason::None) {
+      running_ = false;
+      SendStopReply(reason);
+    }
+    if (machine_.gpio()->marker()) return true;
+  }
+}
+
+void GDBStub::Finish(int exit_code) {
+  if (!connected()) return;
+  std::string reply = "W";
+  AppendByte(reply, exit_code);
+  SendPacket(reply);
+  Disconnect();
+}
+
+void GDBStub::Disconnect() {
+  if (!connected()) return;
+  if (in_fd_ != STDIN_FILENO) close(in_fd_);
+  in_fd_ = out_fd_ = -1;
+  // resume the machine
+  running_ = true;
+  stepping_ = false;
+}
+
+GDBStub::StopReason GDBStub::RunMachine() {
+  std::uint32_t poll_count = 0;
+  while (!machine_.halted() && !machine_.gpio()->marker()) {
+    // check breakpoints
+    if (breaks_.Contains(core_.pc())) {
+      return StopReason::Break;
+    }
+    // run next cycle
+    machine_.NextCycle();
+    if (!watches_.empty() && watches_.CheckAndClearHit()) {
+      return StopReason::Watch;
+    }
+    if (stepping_) return StopReason::Step;
+    // check interrupt requests periodically
+    if (!(++poll_count & kPollMask) && CheckInterrupt()) {
+      return StopReason::Interrupt;
+    }
+  }
+  return StopReason::None;
+}
+
+bool GDBStub::CheckInterrupt() {
+  // check buffered data first
+  if (buf_pos_ < buf_len_) return buf_[buf_pos_++] == kInterruptReq;
+  pollfd pfd = {in_fd_, POLLIN, 0};
+  if (poll(&pfd, 1, 0) <= 0) return false;
+  auto c = GetChar();
+  if (c < 0) {
+    // connection closed
+    Disconnect();
+    return false;
+  }
+  return c == kInterruptReq;
+}
+
+void GDBStub::HandlePackets() {
+  std::string packet;
+  while (connected()) {
+    if (!ReadPacket(packet)) {
+      // connection closed
+      Disconnect();
+      return;
+    }
+    if (HandlePacket(packet)) {
+      running_ = true;
+      return;
+    }
+  }
+}
+
+bool GDBStub::HandlePacket(std::string_view packet) {
+  if (packet.empty()) return false;
+  auto cmd = packet.front();
+  auto args = packet.substr(1);
+  switch (cmd) {
+    case '?': SendStopReply(StopReason::Break); break;
+    case 'g': ReadRegs(); break;
+    case 'G': WriteRegs(args); break;
+    case 'p': ReadReg(args); break;
+    case 'P': WriteReg(args); break;
+    case 'm': ReadMem(args); break;
+    case 'M': WriteMem(args); break;
+    case 'Z': UpdatePoint(args, true); break;
+    case 'z': UpdatePoint(args, false); break;
+    case 'c': case 's': {
+      // resume at specific address
+      std::uint32_t addr;
+      if (ParseHex(args, addr)) core_.set_regs(32, addr);
+      stepping_ = cmd == 's';
+      return true;
+    }
+    case 'D': {
+      SendPacket("OK");
+      Disconnect();
+      break;
+    }
+    case 'k': {
+      killed_ = true;
+      Disconnect();
+      break;
+    }
+    case 'H': case 'T': SendPacket("OK"); break;
+    case 'q': case 'Q': HandleQuery(packet); break;
+    default: SendPacket(""); break;
+  }
+  return false;
+}
+
+void GDBStub::HandleQuery(std::string_view packet) {
+  constexpr std::string_view kXferDesc = "qXfer:features:read:target.xml:";
+  if (packet.substr(0, 11) == "qSupported:" || packet == "qSupported") {
+    std::string reply = "PacketSize=";
+    for (int i = 12; i >= 0; i -= 4) {
+      reply += kHexDigits[(kPacketSize >> i) & 0xf];
+    }
+    SendPacket(reply + ";qXfer:features:read+;QStartNoAckMode+");
+  }
+  else if (packet.substr(0, kXferDesc.size()) == kXferDesc) {
+    // read target description
+    auto args = packet.substr(kXferDesc.size());
+    std::uint32_t offset, len;
+    if (!ParseHex(args, offset) || !ParseSep(args, ',') ||
+        !ParseHex(args, len)) {
+      SendPacket("E01");
+      return;
+    }
+    const auto &desc = GetTargetDesc();
+    if (offset >= desc.size()) {
+      SendPacket("l");
+    }
+    else {
+      auto reply = desc.substr(offset, len);
+      auto last = offset + reply.size() >= desc.size();
+      SendPacket((last ? "l" : "m") + reply);
+    }
+  }
+  else if (packet == "QStartNoAckMode") {
+    SendPacket("OK");
+    no_ack_ = true;
+  }
+  else if (packet == "qAttached") {
+    SendPacket("1");
+  }
+  else if (packet == "qC") {
+    SendPacket("QC1");
+  }
+  else if (packet == "qfThreadInfo") {
+    SendPacket("m1");
+  }
+  else if (packet == "qsThreadInfo") {
+    SendPacket("l");
+  }
+  else {
+    SendPacket("");
+  }
+}
+
+void GDBStub::SendStopReply(StopReason reason) {
+  switch (reason) {
+    case StopReason::Watch: {
+      // report kind & address of watchpoint
+      const auto &info = watches_.hit_watch();
+      std::string reply = "T05";
+      switch (info.kind) {
+        case WatchpointSet::kRead: reply += "rwatch:"; break;
+        case WatchpointSet::kWrite: reply += "watch:"; break;
+        default: reply += "awatch:"; break;
+      }
+      for (int i = 28; i >= 0; i -= 4) {
+        reply += kHexDigits[(info.addr >> i) & 0xf];
+      }
+      SendPacket(reply + ";");
+      break;
+    }
+    case StopReason::Interrupt: SendPacket("S02"); break;
+    default: SendPacket("S05"); break;
+  }
+}
+
+void GDBStub::ReadRegs() {
+  std::string reply;
+  for (std::size_t i = 0; i < kRegCount; ++i) AppendReg(reply, core_.regs(i));
+  SendPacket(reply);
+}
+
+void GDBStub::WriteRegs(std::string_view args) {
+  std::uint32_t values[kRegCount];
+  for (auto &&i : values) {
+    if (!ParseReg(args, i)) return SendPacket("E01");
+  }
+  for (std::size_t i = 0; i < kRegCount; ++i) core_.set_regs(i, values[i]);
+  SendPacket("OK");
+}
+
+void GDBStub::ReadReg(std::string_view args) {
+  std::uint32_t num;
+  if (!ParseHex(args, num) || num >= kRegCount) return SendPacket("E01");
+  std::string reply;
+  AppendReg(reply, core_.regs(num));
+  SendPacket(reply);
+}
+
+void GDBStub::WriteReg(std::string_view args) {
+  std::uint32_t num, value;
+  if (!ParseHex(args, num) || num >= kRegCount || !ParseSep(args, '=') ||
+      !ParseReg(args, value)) {
+    return SendPacket("E01");
+  }
+  core_.set_regs(num, value);
+  SendPacket("OK");
+}
+
+void GDBStub::ReadMem(std::string_view args) {
+  std::uint32_t addr, len;
+  if (!ParseHex(args, addr) || !ParseSep(args, ',') ||
+      !ParseHex(args, len) || len > kPacketSize / 2) {
+    return SendPacket("E01");
+  }
+  std::string reply;
+  for (std::uint32_t i = 0; i < len; ++i) {
+    AppendByte(reply, core_.raw_bus()->ReadByte(addr + i));
+  }
+  SendPacket(reply);
+}
+
+void GDBStub::WriteMem(std::string_view args) {
+  std::uint32_t addr, len;
+  if (!ParseHex(args, addr) || !ParseSep(args, ',') ||
+      !ParseHex(args, len) || !ParseSep(args, ':') ||
+      args.size() != len * 2) {
+    return SendPacket("E01");
+  }
+  for (std::uint32_t i = 0; i < len; ++i) {
+    std::uint8_t byte;
+    if (!ParseByte(args, byte)) return SendPacket("E01");
+    core_.raw_bus()->WriteByte(addr + i, byte);
+  }
+  SendPacket("OK");
+}
+
+void GDBStub::UpdatePoint(std::string_view args, bool insert) {
+  std::uint32_t type, addr, len;
+  if (!ParseHex(args, type) || !ParseSep(args, ',') ||
+      !ParseHex(args, addr) || !ParseSep(args, ',') ||
+      !ParseHex(args, len)) {
+    return SendPacket("E01");
+  }
+  switch (type) {
+    case 0: case 1: {
+      // software/hardware breakpoint
+      if (insert) {
+        breaks_.Add(addr);
+      }
+      else {
+        breaks_.Remove(addr);
+      }
+      break;
+    }
+    case 2: case 3: case 4: {
+      // write/read/access watchpoint
+      auto kind = type == 2   ? WatchpointSet::kWrite
+                  : type == 3 ? WatchpointSet::kRead
+                              : WatchpointSet::kAccess;
+      if (!len) return SendPacket("E01");
+      if (insert) {
+        watches_.Add(0, addr, len, kind);
+      }
+      else {
+        watches_.Remove(addr, len, kind);
+      }
+      break;
+    }
+    default: return SendPacket("");
+  }
+  SendPacket("OK");
+}
+
+int GDBStub::GetChar() {
+  if (buf_pos_ >= buf_len_) {
+    ssize_t len;
+    while ((len = read(in_fd_, buf_, sizeof(buf_))) < 0 && errno == EINTR);
+    if (len <= 0) return -1;
+    buf_pos_ = 0;
+    buf_len_ = len;
+  }
+  return static_cast<unsigned char>(buf_[buf_pos_++]);
+}
+
+bool GDBStub::ReadPacket(std::string &packet) {
+  for (;;) {
+    // find the beginning of packet
+    int c;
+    while ((c = GetChar()) != '$') {
+      if (c < 0) return false;
+    }
+    // read packet data & checksum
+    packet.clear();
+    std::uint8_t sum = 0;
+    while ((c = GetChar()) != '#') {
+      if (c < 0) return false;
+      packet += c;
+      sum += c;
+    }
+    auto hi = GetChar(), lo = GetChar();
+    if (hi < 0 || lo < 0) return false;
+    if (no_ack_) return true;
+    // check & acknowledge
+    if (HexToInt(hi) == (sum >> 4) && HexToInt(lo) == (sum & 0xf)) {
+      return WriteData("+", 1);
+    }
+    if (!WriteData("-", 1)) return false;
+  }
+}
+
+void GDBStub::SendPacket(std::string_view data) {
+  // make packet
+  std::string packet = "$";
+  std::uint8_t sum = 0;
+  for (auto c : data) sum += c;
+  packet += data;
+  packet += '#';
+  AppendByte(packet, sum);
+  // send until acknowledged
+  for (;;) {
+    if (!WriteData(packet.data(), packet.size())) return Disconnect();
+    if (no_ack_) return;
+    int c;
+    while ((c = GetChar()) != '+' && c != '-') {
+      if (c < 0) return Disconnect();
+    }
+    if (c == '+') return;
+  }
+}
+
+bool GDBStub::WriteData(const char *data, std::size_t len) {
+  while (len) {
+    auto ret = write(out_fd_, data, len);
+    if (ret < 0) {
+      if (errno == EINTR) continue;
+      return false;
+    }
+    data += ret;
+    len -= ret;
+  }
+  return true;
+}
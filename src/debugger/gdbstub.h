@@ -0,0 +1,121 @@
+#ifndef RISKY32_DEBUGGER_GDBSTUB_H_
+#define RISKY32_DEBUGGER_GDBSTUB_H_
+
+#include <string>
+#include <string_view>
+#include <cstdio>
+#include <cstdint>
+#include <cstddef>
+
+#include "core/core.h"
+#include "machine/machine.h"
+#include "bus/watchpoint.h"
+#include "debugger/breakpoint.h"
+
+/*
+
+GDB remote serial protocol stub, supported packets:
+
+  ?                     reason of the last stop
+  g/G, p/P              read/write registers (x0-x31, pc)
+  m/M                   read/write memory (physical address)
+  c/s                   continue/step
+  Z0/z0, Z1/z1          insert/remove breakpoints (host side)
+  Z2/z2, Z3/z3, Z4/z4   insert/remove write/read/access watchpoints
+  D/k                   detach/kill
+  qSupported, qXfer:features:read, QStartNoAckMode and some other
+  queries required by GDB
+
+Between stops, the machine runs in a tight loop, and the connection is
+polled for interrupt requests (C-c) periodically.
+
+In stdio mode, packets are read from stdin, so console input of guest
+is redirected to '/dev/null'.
+
+*/
+
+class GDBStub {
+ public:
+  GDBStub(Machine &machine)
+      : machine_(machine), core_(machine.core()), listen_fd_(-1),
+        in_fd_(-1), out_fd_(-1), null_input_(nullptr), no_ack_(false),
+        running_(false), stepping_(false), killed_(false), buf_pos_(0),
+        buf_len_(0) {}
+  ~GDBStub();
+
+  // wait for GDB to connect to specific TCP port on localhost,
+  // or use stdin/stdout if 'port' is "-", returns false if failed
+  bool Connect(std::string_view port);
+  // handle requests from GDB and run the machine,
+  // returns when guest halts or writes the marker,
+  // or returns false if GDB has killed the machine
+  bool Run();
+  // report exit code to GDB and close connection
+  void Finish(int exit_code);
+
+ private:
+  // reason of stopping
+  enum class StopReason { None, Step, Break, Watch, Interrupt };
+
+  // check if connected to GDB
+  bool connected() const { return out_fd_ >= 0; }
+  // close connection (GDB will be detached)
+  void Disconnect();
+
+  // run machine until stopped, guest halts or writes the marker
+  StopReason RunMachine();
+  // check if GDB has sent an interrupt request
+  bool CheckInterrupt();
+
+  // handle packets until GDB resumes the machine or detaches
+  void HandlePackets();
+  // handle a packet, returns true if need to resume the machine
+  bool HandlePacket(std::string_view packet);
+  // handle query packets
+  void HandleQuery(std::string_view packet);
+  // send reply of stop reason
+  void SendStopReply(StopReason reason);
+  // read/write all registers ('g'/'G' packets)
+  void ReadRegs();
+  void WriteRegs(std::string_view args);
+  // read/write a single register ('p'/'P' packets)
+  void ReadReg(std::string_view args);
+  void WriteReg(std::string_view args);
+  // read/write memory ('m'/'M' packets)
+  void ReadMem(std::string_view args);
+  void WriteMem(std::string_view args);
+  // insert/remove breakpoints & watchpoints ('Z'/'z' packets)
+  void UpdatePoint(std::string_view args, bool insert);
+
+  // read a character from connection, returns -1 if failed
+  int GetChar();
+  // read a packet from connection, returns false if failed
+  bool ReadPacket(std::string &packet);
+  // send a packet to GDB
+  void SendPacket(std::string_view data);
+  // write raw data to connection, returns false if failed
+  bool WriteData(const char *data, std::size_t len);
+
+  // reference of machine & emulation core
+  Machine &machine_;
+  Core &core_;
+  // listening socket & file descriptors of connection
+  int listen_fd_, in_fd_, out_fd_;
+  // console input of guest in stdio mode
+  std::FILE *null_input_;
+  // no acknowledgment mode
+  bool no_ack_;
+  // running & stepping flag
+  bool running_, stepping_;
+  // set if GDB has sent a kill request
+  bool killed_;
+  // all breakpoints
+  BreakpointSet breaks_;
+  // all watchpoints
+  WatchpointSet watches_;
+  // input buffer
+  char buf_[4096];
+  std::size_t buf_pos_, buf_len_;
+};
+
+#endif  // RISKY32_DEBUGGER_GDBSTUB_H_
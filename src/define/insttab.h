@@ -0,0 +1,194 @@
+#ifndef RISKY32_DEFINE_INSTTAB_H_
+#define RISKY32_DEFINE_INSTTAB_H_
+
+#include <array>
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
+
+#include "util/bitpat.h"
+
+/*
+
+Declarative table of all supported instructions, shared by the core
+(dispatching to functional units) and the disassembler.
+
+Patterns are compiled into a flat decision tree ('BitMatch') at compile
+time. Rows with empty mask (e.g. 'unimp') match when nothing else does,
+and more specific rows (e.g. 'nop') take precedence over general ones.
+
+*/
+
+// functional unit that executes the instruction
+enum class InstUnit : std::uint8_t {
+  None,       // illegal instruction
+  Int, LoadStore, Branch, System,
+};
+
+// count of functional units
+inline constexpr std::size_t kInstUnitCount = 5;
+
+// format of instruction (decides which 'Execute' method of unit is used)
+enum class InstFormat : std::uint8_t { R, I, S, U };
+
+// immediate encoding variants
+enum class ImmEncode : std::uint8_t {
+  R,  // no immediate
+  I,  // inst[31:20]
+  S,  // {inst[31:25], inst[11:7]}
+  B,  // {inst[31], inst[7], inst[30:25], inst[11:8], 1'b0}
+  U,  // {inst[31:12]}
+  J,  // {inst[31], inst[19:12], inst[20], inst[30:21], 1'b0}
+};
+
+// assembly format
+enum class AsmFormat : std::uint8_t {
+  None,         // ECALL, FENCE.I
+  RegRegReg,    // normal R-type
+  RegRegImm,    // normal I-type
+  RegRegSmt,    // SLLI
+  RegReg,       // SFENCE.VMA
+  RegImm,       // LUI
+  RegTarget,    // JAL
+  RegRegTarget, // BEQ
+  RegBaseImm,   // JALR, LW
+  MemOrder,     // FENCE
+  AMO2,         // LR.W
+  AMO3,         // SC.W, AMOSWAP.W
+  CSRReg,       // CSRRW
+  CSRImm,       // CSRRWI
+};
+
+// information of instruction
+struct InstInfo {
+  std::string_view  name;
+  BitPat32          pattern;
+  InstUnit          unit;
+  InstFormat        format;
+  ImmEncode         imm;
+  AsmFormat         asm_format;
+};
+
+// table of all instructions
+inline constexpr InstInfo kInstTable[] = {
+  // arithmetic
+  {"add", {"0000000??????????000?????0110011"}, InstUnit::Int, InstFormat::R, ImmEncode::R, AsmFormat::RegRegReg},
+  {"addi", {"?????????????????000?????0010011"}, InstUnit::Int, InstFormat::I, ImmEncode::I, AsmFormat::RegRegImm},
+  {"sub", {"0100000??????????000?????0110011"}, InstUnit::Int, InstFormat::R, ImmEncode::R, AsmFormat::RegRegReg},
+  {"lui", {"?????????????????????????0110111"}, InstUnit::Int, InstFormat::U, ImmEncode::U, AsmFormat::RegImm},
+  {"auipc", {"?????????????????????????0010111"}, InstUnit::Int, InstFormat::U, ImmEncode::U, AsmFormat::RegImm},
+  // logical
+  {"xor", {"0000000??????????100?????0110011"}, InstUnit::Int, InstFormat::R, ImmEncode::R, AsmFormat::RegRegReg},
+  {"xori", {"?????????????????100?????0010011"}, InstUnit::Int, InstFormat::I, ImmEncode::I, AsmFormat::RegRegImm},
+  {"or", {"0000000??????????110?????0110011"}, InstUnit::Int, InstFormat::R, ImmEncode::R, AsmFormat::RegRegReg},
+  {"ori", {"?????????????????110?????0010011"}, InstUnit::Int, InstFormat::I, ImmEncode::I, AsmFormat::RegRegImm},
+  {"and", {"0000000??????????111?????0110011"}, InstUnit::Int, InstFormat::R, ImmEncode::R, AsmFormat::RegRegReg},
+  {"andi", {"?????????????????111?????0010011"}, InstUnit::Int, InstFormat::I, ImmEncode::I, AsmFormat::RegRegImm},
+  // compare
+  {"slt", {"0000000??????????010?????0110011"}, InstUnit::Int, InstFormat::R, ImmEncode::R, AsmFormat::RegRegReg},
+  {"slti", {"?????????????????010?????0010011"}, InstUnit::Int, InstFormat::I, ImmEncode::I, AsmFormat::RegRegImm},
+  {"sltu", {"0000000??????????011?????0110011"}, InstUnit::Int, InstFormat::R, ImmEncode::R, AsmFormat::RegRegReg},
+  {"sltiu", {"?????????????????011?????0010011"}, InstUnit::Int, InstFormat::I, ImmEncode::I, AsmFormat::RegRegImm},
+  // shift ('SLLI', 'SRLI' and 'SRAI' are treated as R-type)
+  {"sll", {"0000000??????????001?????0110011"}, InstUnit::Int, InstFormat::R, ImmEncode::R, AsmFormat::RegRegReg},
+  {"slli", {"0000000??????????001?????0010011"}, InstUnit::Int, InstFormat::R, ImmEncode::R, AsmFormat::RegRegSmt},
+  {"srl", {"0000000??????????101?????0110011"}, InstUnit::Int, InstFormat::R, ImmEncode::R, AsmFormat::RegRegReg},
+  {"srli", {"0000000??????????101?????0010011"}, InstUnit::Int, InstFormat::R, ImmEncode::R, AsmFormat::RegRegSmt},
+  {"sra", {"0100000??????????101?????0110011"}, InstUnit::Int, InstFormat::R, ImmEncode::R, AsmFormat::RegRegReg},
+  {"srai", {"0100000??????????101?????0010011"}, InstUnit::Int, InstFormat::R, ImmEncode::R, AsmFormat::RegRegSmt},
+  // branch & jump
+  {"beq", {"?????????????????000?????1100011"}, InstUnit::Branch, InstFormat::S, ImmEncode::B, AsmFormat::RegRegTarget},
+  {"bne", {"?????????????????001?????1100011"}, InstUnit::Branch, InstFormat::S, ImmEncode::B, AsmFormat::RegRegTarget},
+  {"blt", {"?????????????????100?????1100011"}, InstUnit::Branch, InstFormat::S, ImmEncode::B, AsmFormat::RegRegTarget},
+  {"bge", {"?????????????????101?????1100011"}, InstUnit::Branch, InstFormat::S, ImmEncode::B, AsmFormat::RegRegTarget},
+  {"bltu", {"?????????????????110?????1100011"}, InstUnit::Branch, InstFormat::S, ImmEncode::B, AsmFormat::RegRegTarget},
+  {"bgeu", {"?????????????????111?????1100011"}, InstUnit::Branch, InstFormat::S, ImmEncode::B, AsmFormat::RegRegTarget},
+  {"jal", {"?????????????????????????1101111"}, InstUnit::Branch, InstFormat::U, ImmEncode::J, AsmFormat::RegTarget},
+  {"jalr", {"?????????????????000?????1100111"}, InstUnit::Branch, InstFormat::I, ImmEncode::I, AsmFormat::RegBaseImm},
+  // load & store
+  {"lb", {"?????????????????000?????0000011"}, InstUnit::LoadStore, InstFormat::I, ImmEncode::I, AsmFormat::RegBaseImm},
+  {"lh", {"?????????????????001?????0000011"}, InstUnit::LoadStore, InstFormat::I, ImmEncode::I, AsmFormat::RegBaseImm},
+  {"lw", {"?????????????????010?????0000011"}, InstUnit::LoadStore, InstFormat::I, ImmEncode::I, AsmFormat::RegBaseImm},
+  {"lbu", {"?????????????????100?????0000011"}, InstUnit::LoadStore, InstFormat::I, ImmEncode::I, AsmFormat::RegBaseImm},
+  {"lhu", {"?????????????????101?????0000011"}, InstUnit::LoadStore, InstFormat::I, ImmEncode::I, AsmFormat::RegBaseImm},
+  {"sb", {"?????????????????000?????0100011"}, InstUnit::LoadStore, InstFormat::S, ImmEncode::S, AsmFormat::RegBaseImm},
+  {"sh", {"?????????????????001?????0100011"}, InstUnit::LoadStore, InstFormat::S, ImmEncode::S, AsmFormat::RegBaseImm},
+  {"sw", {"?????????????????010?????0100011"}, InstUnit::LoadStore, InstFormat::S, ImmEncode::S, AsmFormat::RegBaseImm},
+  // sync (reserved fields are ignored, as required by the spec)
+  {"fence", {"?????????????????000?????0001111"}, InstUnit::LoadStore, InstFormat::I, ImmEncode::I, AsmFormat::MemOrder},
+  {"fence.i", {"?????????????????001?????0001111"}, InstUnit::LoadStore, InstFormat::I, ImmEncode::I, AsmFormat::None},
+  // CSR access
+  {"csrrw", {"?????????????????001?????1110011"}, InstUnit::System, InstFormat::I, ImmEncode::I, AsmFormat::CSRReg},
+  {"csrrs", {"?????????????????010?????1110011"}, InstUnit::System, InstFormat::I, ImmEncode::I, AsmFormat::CSRReg},
+  {"csrrc", {"?????????????????011?????1110011"}, InstUnit::System, InstFormat::I, ImmEncode::I, AsmFormat::CSRReg},
+  {"csrrwi", {"?????????????????101?????1110011"}, InstUnit::System, InstFormat::I, ImmEncode::I, AsmFormat::CSRImm},
+  {"csrrsi", {"?????????????????110?????1110011"}, InstUnit::System, InstFormat::I, ImmEncode::I, AsmFormat::CSRImm},
+  {"csrrci", {"?????????????????111?????1110011"}, InstUnit::System, InstFormat::I, ImmEncode::I, AsmFormat::CSRImm},
+  // multiplication & division
+  {"mul", {"0000001??????????000?????0110011"}, InstUnit::Int, InstFormat::R, ImmEncode::R, AsmFormat::RegRegReg},
+  {"mulh", {"0000001??????????001?????0110011"}, InstUnit::Int, InstFormat::R, ImmEncode::R, AsmFormat::RegRegReg},
+  {"mulhsu", {"0000001??????????010?????0110011"}, InstUnit::Int, InstFormat::R, ImmEncode::R, AsmFormat::RegRegReg},
+  {"mulhu", {"0000001??????????011?????0110011"}, InstUnit::Int, InstFormat::R, ImmEncode::R, AsmFormat::RegRegReg},
+  {"div", {"0000001??????????100?????0110011"}, InstUnit::Int, InstFormat::R, ImmEncode::R, AsmFormat::RegRegReg},
+  {"divu", {"0000001??????????101?????0110011"}, InstUnit::Int, InstFormat::R, ImmEncode::R, AsmFormat::RegRegReg},
+  {"rem", {"0000001??????????110?????0110011"}, InstUnit::Int, InstFormat::R, ImmEncode::R, AsmFormat::RegRegReg},
+  {"remu", {"0000001??????????111?????0110011"}, InstUnit::Int, InstFormat::R, ImmEncode::R, AsmFormat::RegRegReg},
+  // atomic
+  {"lr.w", {"00010??00000?????010?????0101111"}, InstUnit::LoadStore, InstFormat::R, ImmEncode::R, AsmFormat::AMO2},
+  {"sc.w", {"00011????????????010?????0101111"}, InstUnit::LoadStore, InstFormat::R, ImmEncode::R, AsmFormat::AMO3},
+  {"amoswap.w", {"00001????????????010?????0101111"}, InstUnit::LoadStore, InstFormat::R, ImmEncode::R, AsmFormat::AMO3},
+  {"amoadd.w", {"00000????????????010?????0101111"}, InstUnit::LoadStore, InstFormat::R, ImmEncode::R, AsmFormat::AMO3},
+  {"amoxor.w", {"00100????????????010?????0101111"}, InstUnit::LoadStore, InstFormat::R, ImmEncode::R, AsmFormat::AMO3},
+  {"amoand.w", {"01100????????????010?????0101111"}, InstUnit::LoadStore, InstFormat::R, ImmEncode::R, AsmFormat::AMO3},
+  {"amoor.w", {"01000????????????010?????0101111"}, InstUnit::LoadStore, InstFormat::R, ImmEncode::R, AsmFormat::AMO3},
+  {"amomin.w", {"10000????????????010?????0101111"}, InstUnit::LoadStore, InstFormat::R, ImmEncode::R, AsmFormat::AMO3},
+  {"amomax.w", {"10100????????????010?????0101111"}, InstUnit::LoadStore, InstFormat::R, ImmEncode::R, AsmFormat::AMO3},
+  {"amominu.w", {"11000????????????010?????0101111"}, InstUnit::LoadStore, InstFormat::R, ImmEncode::R, AsmFormat::AMO3},
+  {"amomaxu.w", {"11100????????????010?????0101111"}, InstUnit::LoadStore, InstFormat::R, ImmEncode::R, AsmFormat::AMO3},
+  // privilege
+  {"ecall", {"00000000000000000000000001110011"}, InstUnit::System, InstFormat::I, ImmEncode::I, AsmFormat::None},
+  {"ebreak", {"00000000000100000000000001110011"}, InstUnit::System, InstFormat::I, ImmEncode::I, AsmFormat::None},
+  {"sret", {"00010000001000000000000001110011"}, InstUnit::System, InstFormat::I, ImmEncode::R, AsmFormat::None},
+  {"mret", {"00110000001000000000000001110011"}, InstUnit::System, InstFormat::I, ImmEncode::R, AsmFormat::None},
+  {"wfi", {"00010000010100000000000001110011"}, InstUnit::System, InstFormat::I, ImmEncode::R, AsmFormat::None},
+  {"sfence.vma", {"0001001??????????000000001110011"}, InstUnit::System, InstFormat::R, ImmEncode::R, AsmFormat::RegReg},
+  // pseudo instruction
+  {"nop", {"00000000000000000000000000010011"}, InstUnit::Int, InstFormat::I, ImmEncode::I, AsmFormat::None},
+  // unknown
+  {"unimp", {"????????????????????????????????"}, InstUnit::None, InstFormat::R, ImmEncode::R, AsmFormat::None},
+};
+
+namespace inst_table {
+
+// count of instructions in table
+inline constexpr std::size_t kInstCount =
+    sizeof(kInstTable) / sizeof(InstInfo);
+
+// get matching rules (pattern to index of instruction)
+constexpr auto GetRules() {
+  std::array<std::pair<BitPat32, std::uint16_t>, kInstCount> rules = {};
+  for (std::size_t i = 0; i < kInstCount; ++i) {
+    // 'std::pair::operator=' is not 'constexpr' in C++17
+    rules[i].first = kInstTable[i].pattern;
+    rules[i].second = i;
+  }
+  return rules;
+}
+
+// decision tree of instruction table
+inline constexpr BitMatch32<std::uint16_t, kInstCount> kInstMatch =
+    GetRules();
+static_assert(kInstMatch.valid(), "conflicts in instruction table");
+static_assert(kInstMatch.Find(0), "default instruction is required");
+// index of default instruction
+inline constexpr std::uint16_t kDefaultInst = *kInstMatch.Find(0);
+
+}  // namespace inst_table
+
+// decode instruction, returns index of instruction in 'kInstTable'
+inline std::size_t DecodeInst(std::uint32_t inst_data) {
+  using namespace inst_table;
+  return kInstMatch.Find(inst_data, kDefaultInst);
+}
+
+#endif  // RISKY32_DEFINE_INSTTAB_H_
@@ -11,6 +11,5 @@ constexpr std::uint32_t kMMIOAddrRAM      = 0x80000000;
 constexpr std::uint32_t kMMIOAddrGPIO     = 0x90000000;
 constexpr std::uint32_t kMMIOAddrCLINT    = 0x90010000;
 constexpr std::uint32_t kMMIOAddrFlash    = 0x90020000;
-constexpr std::uint32_t kMMIOAddrDebugger = 0xfffffff0;
 
 #endif  // RISKY32_DEFINE_MMIO_H_
@@ -0,0 +1,80 @@
+#include "machine/forksrv.h"
+
+#include <cstring>
+#include <cstdint>
+#include <cerrno>
+
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+ForkServer::~ForkServer() {
+  if (input_) std::fclose(input_);
+  if (output_) std::fclose(output_);
+  if (listen_fd_ >= 0) {
+    close(listen_fd_);
+    unlink(path_.c_str());
+  }
+}
+
+bool ForkServer::Listen(std::string_view path) {
+  // check length of path
+  sockaddr_un addr = {};
+  if (path.size() >= sizeof(addr.sun_path)) return false;
+  addr.sun_family = AF_UNIX;
+  std::memcpy(addr.sun_path, path.data(), path.size());
+  // create socket
+  listen_fd_ = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listen_fd_ < 0) return false;
+  path_ = path;
+  unlink(path_.c_str());
+  if (bind(listen_fd_, reinterpret_cast<sockaddr *>(&addr),
+           sizeof(addr)) < 0) {
+    return false;
+  }
+  return listen(listen_fd_, SOMAXCONN) == 0;
+}
+
+bool ForkServer::Serve() {
+  // reap child processes automatically
+  signal(SIGCHLD, SIG_IGN);
+  // flush all streams, avoid duplicated outputs in child processes
+  std::fflush(nullptr);
+  for (;;) {
+    // accept a new request
+    auto fd = accept(listen_fd_, nullptr, nullptr);
+    if (fd < 0) {
+      if (errno == EINTR || errno == ECONNABORTED) continue;
+      return false;
+    }
+    // create child process
+    auto pid = fork();
+    if (!pid) {
+      // child process, redirect console to connection
+      signal(SIGCHLD, SIG_DFL);
+      close(listen_fd_);
+      listen_fd_ = -1;
+      input_ = fdopen(fd, "r");
+      output_ = fdopen(dup(fd), "w");
+      if (!input_ || !output_) return false;
+      machine_.gpio()->set_input(input_);
+      machine_.gpio()->set_output(output_);
+      return true;
+    }
+    // parent process (or failed to fork)
+    close(fd);
+    if (pid < 0) return false;
+  }
+}
+
+void ForkServer::Finish(int exit_code) {
+  if (!output_) return;
+  // send exit code in little endian
+  auto code = static_cast<std::uint32_t>(exit_code);
+  for (int i = 0; i < 4; ++i) {
+    std::fputc((code >> (i * 8)) & 0xff, output_);
+  }
+  std::fclose(output_);
+  output_ = nullptr;
+}
@@ -0,0 +1,52 @@
+#ifndef RISKY32_MACHINE_FORKSRV_H_
+#define RISKY32_MACHINE_FORKSRV_H_
+
+#include <string>
+#include <string_view>
+#include <cstdio>
+
+#include "machine/machine.h"
+
+/*
+
+Protocol of fork server (one request per connection):
+
+  request:    console input of guest, terminated by closing the
+              write side of connection (e.g. 'shutdown(SHUT_WR)')
+  response:   console output of guest, followed by the exit code
+              of guest (register 'a0', 4 bytes, little endian)
+
+Each request is served by a forked child process, which continues from
+the state of machine when the server started, and shares all memories
+with server via copy-on-write pages of kernel.
+
+*/
+
+// fork server on Unix domain socket
+class ForkServer {
+ public:
+  ForkServer(Machine &machine)
+      : machine_(machine), listen_fd_(-1), input_(nullptr),
+        output_(nullptr) {}
+  ~ForkServer();
+
+  // listen on specific Unix domain socket, returns false if failed
+  bool Listen(std::string_view path);
+  // serve requests, returns true only in child processes,
+  // or returns false if any error occurred
+  bool Serve();
+  // finish current request with exit code (child process only)
+  void Finish(int exit_code);
+
+ private:
+  // reference of machine
+  Machine &machine_;
+  // path of socket
+  std::string path_;
+  // listening socket
+  int listen_fd_;
+  // input & output stream of connection (child process only)
+  std::FILE *input_, *output_;
+};
+
+#endif  // RISKY32_MACHINE_FORKSRV_H_
@@ -0,0 +1,317 @@
+#include "machine/machine.h"
+
+#include <iomanip>
+#include <utility>
+
+#include "define/mmio.h"
+#include "debugger/disasm.h"
+#include "util/snapshot.h"
+#include "util/selfprof.h"
+
+namespace {
+
+// wait states of data accesses to memories & devices
+constexpr std::uint32_t kROMWaitStates = 2;
+constexpr std::uint32_t kRAMWaitStates = 1;
+constexpr std::uint32_t kDeviceWaitStates = 4;
+
+// instructions between two updates of performance counters
+constexpr std::uint32_t kPerfQuantum = 1 << 20;
+
+// print a 32-bit value in hexadecimal
+std::ostream &PrintHex(std::ostream &os, std::uint32_t value) {
+  return os << "0x" << std::hex << std::setw(8) << std::setfill('0')
+            << value << std::dec << std::setfill(' ');
+}
+
+// print a record of commit log
+void PrintRecord(std::ostream &os, const CommitRecord &rec,
+                 const SymbolTable &symbols) {
+  os << "pc ";
+  PrintHex(os, rec.pc) << "  inst ";
+  PrintHex(os, rec.inst) << "  ";
+  if (!rec.has_wb) {
+    os << "(no write-back info)";
+  }
+  else if (rec.rd) {
+    os << 'x' << std::left << std::setw(2) << rec.rd << std::right
+       << " <- ";
+    PrintHex(os, rec.rd_value);
+  }
+  else {
+    os << "(no write-back)";
+  }
+  auto disasm = Disassemble(rec.inst, rec.pc, &symbols);
+  os << "  " << disasm.first << ' ' << disasm.second << std::endl;
+}
+
+}  // namespace
+
+Machine::Machine(std::size_t mem_size)
+    : rom_(std::make_shared<ROM>()), flash_(std::make_shared<ROM>()),
+      ram_(std::make_shared<RAM>(mem_size)),
+      gpio_(std::make_shared<GPIO>()), clint_(std::make_shared<CLINT>()),
+      bus_(std::make_shared<Bus>()), core_(bus_) {
+  // initialize system bus
+  bus_->AddPeripheral(kMMIOAddrRAM, ram_);
+  bus_->AddPeripheral(kMMIOAddrGPIO, gpio_);
+  bus_->AddPeripheral(kMMIOAddrCLINT, clint_);
+  // initialize core
+  core_.set_timer_int(clint_->timer_int());
+  core_.set_soft_int(clint_->soft_int());
+  // initialize devices
+  gpio_->set_retired_count(core_.retired_count());
+}
+
+bool Machine::LoadROM(std::string_view file) {
+  if (!rom_->LoadBinary(file)) return false;
+  return bus_->AddPeripheral(kMMIOAddrROM, rom_);
+}
+
+bool Machine::LoadFlash(std::string_view file) {
+  if (!flash_->LoadBinary(file)) return false;
+  return !flash_->size() || bus_->AddPeripheral(kMMIOAddrFlash, flash_);
+}
+
+void Machine::Reset() {
+  core_.Reset();
+}
+
+void Machine::StartProfiling() {
+  profiler_.AddRegion(kMMIOAddrROM, rom_->size());
+  profiler_.AddRegion(kMMIOAddrRAM, ram_->size());
+  profiler_.AddRegion(kMMIOAddrFlash, flash_->size());
+  core_.set_profiler(&profiler_);
+}
+
+void Machine::StartCallGraph(std::uint32_t sample_period) {
+  call_graph_ = std::make_unique<CallGraphProfiler>(sample_period);
+  call_graph_->Reset(core_.pc());
+  core_.set_call_graph(call_graph_.get());
+}
+
+bool Machine::EnableCache(std::string_view spec) {
+  if (!cache_.Configure(spec)) return false;
+  // GPIO & CLINT are not cacheable
+  cache_.AddUncached(kMMIOAddrGPIO, kMMIOAddrFlash - kMMIOAddrGPIO);
+  core_.set_cache(&cache_);
+  return true;
+}
+
+bool Machine::StartBranchModel(std::string_view predictor) {
+  auto dir_pred = MakeDirectionPredictor(predictor);
+  if (!dir_pred) return false;
+  branch_model_ = std::make_unique<BranchModel>(std::move(dir_pred));
+  core_.set_branch_model(branch_model_.get());
+  return true;
+}
+
+void Machine::StartTiming() {
+  timing_.AddRegion(kMMIOAddrROM, rom_->size(), kROMWaitStates);
+  timing_.AddRegion(kMMIOAddrRAM, ram_->size(), kRAMWaitStates);
+  timing_.AddRegion(kMMIOAddrGPIO, kMMIOAddrFlash - kMMIOAddrGPIO,
+                    kDeviceWaitStates);
+  timing_.AddRegion(kMMIOAddrFlash, flash_->size(), kROMWaitStates);
+  core_.set_timing(&timing_);
+}
+
+bool Machine::StartBBV(std::string_view file, std::uint64_t interval) {
+  bbv_ = std::make_unique<BBVCollector>(interval);
+  return bbv_->Open(file);
+}
+
+bool Machine::StartTrace(std::string_view file) {
+  if (!tracer_.Open(file)) return false;
+  core_.set_tracer(&tracer_);
+  return true;
+}
+
+bool Machine::StartLockstep(std::string_view file) {
+  if (!checker_.Open(file)) return false;
+  core_.set_checker(&checker_);
+  return true;
+}
+
+void Machine::PrintLockstepReport(std::ostream &os) {
+  if (!checker_.diverged()) {
+    os << "lockstep: " << checker_.checked() << " instructions matched";
+    if (checker_.log_failed()) {
+      os << ", reference log is malformed";
+    }
+    else if (checker_.log_ended()) {
+      os << ", reached the end of reference log";
+    }
+    os << std::endl;
+    return;
+  }
+  // print diverged instruction
+  os << "lockstep: diverged from reference log after "
+     << checker_.checked() << " matched instructions" << std::endl;
+  os << "  expected: ";
+  PrintRecord(os, checker_.expected(), symbols_);
+  os << "  actual:   ";
+  PrintRecord(os, checker_.actual(), symbols_);
+  // print state of core after the diverged instruction
+  os << "core state after the diverged instruction:" << std::endl;
+  os << "  pc ";
+  PrintHex(os, core_.regs(32)) << "  priv " << core_.csr().cur_priv()
+                               << "  mstatus ";
+  PrintHex(os, core_.csr().mstatus()) << "  mepc ";
+  PrintHex(os, core_.csr().mepc()) << "  mcause ";
+  PrintHex(os, core_.csr().mcause()) << std::endl;
+  for (std::size_t i = 0; i < 32; ++i) {
+    os << "  x" << std::left << std::setw(3) << i << std::right;
+    PrintHex(os, core_.regs(i));
+    if (i % 4 == 3) os << std::endl;
+  }
+  os << "  retired " << *core_.retired_count() << std::endl;
+}
+
+bool Machine::StartPerfShm(std::string_view name) {
+  if (!perf_shm_.Open(name)) return false;
+  PublishPerf();
+  return true;
+}
+
+void Machine::FinishPerfShm() {
+  if (!perf_shm_.is_open()) return;
+  PublishPerf();
+  perf_shm_.Close();
+}
+
+void Machine::PublishPerf() {
+  PerfCounters counters = {};
+  counters.retired = *core_.retired_count();
+  counters.exceptions = core_.exception_count();
+  counters.interrupts = core_.interrupt_count();
+  counters.page_walks = core_.mmu().page_walk_count();
+  counters.io_input = gpio_->input_bytes();
+  counters.io_output = gpio_->output_bytes();
+  perf_shm_.Publish(counters);
+}
+
+template <typename Instrument>
+void Machine::RunWith(Instrument &instrument) {
+  SELF_PROFILE_SCOPE(Run);
+  if (!perf_shm_.is_open()) {
+    while (running()) {
+      clint_->UpdateTimer();
+      core_.NextCycle(instrument);
+    }
+    return;
+  }
+  // publish performance counters at quantum boundaries
+  while (running()) {
+    for (auto n = kPerfQuantum; n && running(); --n) {
+      clint_->UpdateTimer();
+      core_.NextCycle(instrument);
+    }
+    PublishPerf();
+  }
+}
+
+template <typename Instrument>
+void Machine::NextCycleWith(Instrument &instrument) {
+  clint_->UpdateTimer();
+  core_.NextCycle(instrument);
+}
+
+void Machine::Run() {
+  if (inst_mix_ && bbv_) {
+    InstrumentPair<InstMixStats, BBVCollector> both{*inst_mix_, *bbv_};
+    return RunWith(both);
+  }
+  if (inst_mix_) return RunWith(*inst_mix_);
+  if (bbv_) return RunWith(*bbv_);
+  NoInstrument none;
+  RunWith(none);
+}
+
+void Machine::NextCycle() {
+  if (inst_mix_ && bbv_) {
+    InstrumentPair<InstMixStats, BBVCollector> both{*inst_mix_, *bbv_};
+    return NextCycleWith(both);
+  }
+  if (inst_mix_) return NextCycleWith(*inst_mix_);
+  if (bbv_) return NextCycleWith(*bbv_);
+  NoInstrument none;
+  NextCycleWith(none);
+}
+
+void Machine::SaveStates(SnapshotWriter &writer) const {
+  core_.SaveState(writer);
+  gpio_->SaveState(writer);
+  clint_->SaveState(writer);
+}
+
+bool Machine::LoadStates(SnapshotReader &reader) {
+  return core_.LoadState(reader) && gpio_->LoadState(reader) &&
+         clint_->LoadState(reader);
+}
+
+bool Machine::SaveSnapshot(std::string_view file) {
+  SnapshotWriter writer;
+  if (!writer.Open(file)) return false;
+  SaveStates(writer);
+  rom_->SaveState(writer);
+  flash_->SaveState(writer);
+  ram_->SaveState(writer);
+  return writer.Close();
+}
+
+bool Machine::LoadSnapshot(std::string_view file) {
+  SnapshotReader reader;
+  if (!reader.Open(file)) return false;
+  // checkpoints are no longer valid
+  checkpoints_.clear();
+  return LoadStates(reader) && rom_->LoadState(reader) &&
+         flash_->LoadState(reader) && ram_->LoadState(reader);
+}
+
+void Machine::Checkpoint() {
+  checkpoints_.clear();
+  checkpoints_.emplace_back();
+  SnapshotWriter writer;
+  writer.Open(checkpoints_.back());
+  SaveStates(writer);
+  // start journaling memories
+  rom_->Checkpoint();
+  flash_->Checkpoint();
+  ram_->Checkpoint();
+}
+
+void Machine::PushCheckpoint() {
+  if (checkpoints_.empty()) return Checkpoint();
+  checkpoints_.emplace_back();
+  SnapshotWriter writer;
+  writer.Open(checkpoints_.back());
+  SaveStates(writer);
+  // start new epochs of memory journals
+  rom_->PushCheckpoint();
+  flash_->PushCheckpoint();
+  ram_->PushCheckpoint();
+}
+
+bool Machine::Restore(std::size_t n) {
+  if (n >= checkpoints_.size()) return false;
+  SnapshotReader reader;
+  const auto &cp = checkpoints_[checkpoints_.size() - 1 - n];
+  if (!reader.Open(cp) || !LoadStates(reader)) return false;
+  // roll back all dirty pages
+  rom_->Restore(n);
+  flash_->Restore(n);
+  ram_->Restore(n);
+  checkpoints_.resize(checkpoints_.size() - n);
+  // shadow call stack can not be rolled back
+  if (call_graph_) call_graph_->Reset(core_.pc());
+  return true;
+}
+
+void Machine::DropOldestCheckpoint() {
+  // the last checkpoint can not be dropped
+  if (checkpoints_.size() <= 1) return;
+  checkpoints_.pop_front();
+  rom_->DropOldestCheckpoint();
+  flash_->DropOldestCheckpoint();
+  ram_->DropOldestCheckpoint();
+}
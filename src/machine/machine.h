@@ -0,0 +1,211 @@
+#ifndef RISKY32_MACHINE_MACHINE_H_
+#define RISKY32_MACHINE_MACHINE_H_
+
+#include <memory>
+#include <ostream>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <cstdint>
+#include <cstddef>
+
+#include "core/core.h"
+#include "bus/bus.h"
+#include "bus/cache.h"
+#include "peripheral/general/gpio.h"
+#include "peripheral/interrupt/clint.h"
+#include "peripheral/storage/ram.h"
+#include "peripheral/storage/rom.h"
+#include "util/symtab.h"
+#include "util/profiler.h"
+#include "util/callgraph.h"
+#include "util/branchpred.h"
+#include "util/instmix.h"
+#include "util/bbv.h"
+#include "util/lockstep.h"
+#include "util/perfshm.h"
+#include "util/trapstats.h"
+#include "core/timing.h"
+
+// the whole emulated machine (core, bus and all peripherals)
+class Machine {
+ public:
+  Machine(std::size_t mem_size);
+
+  // load binary file to ROM, returns false if failed
+  bool LoadROM(std::string_view file);
+  // load binary file to flash, returns false if failed
+  bool LoadFlash(std::string_view file);
+  // load symbols from ELF file, returns false if failed
+  bool LoadSymbols(std::string_view file) {
+    return symbols_.LoadELF(file);
+  }
+  // reset the core
+  void Reset();
+  // start profiling retired instructions in all memories
+  void StartProfiling();
+  // write profile report to file, returns false if failed
+  bool WriteProfile(std::string_view file) const {
+    return profiler_.WriteReport(file, symbols_);
+  }
+  // start call-graph profiling, with current PC as the root frame
+  void StartCallGraph(std::uint32_t sample_period);
+  // write samples of call-graph profiling to file in folded-stack
+  // format, returns false if failed
+  bool WriteCallGraph(std::string_view file) const {
+    return call_graph_ && call_graph_->WriteFolded(file, symbols_);
+  }
+  // start modelling cache hierarchy by configuration string
+  // returns false if configuration is invalid
+  bool EnableCache(std::string_view spec);
+  // write cache statistics to file, returns false if failed
+  bool WriteCacheReport(std::string_view file) const {
+    return cache_.WriteReport(file, symbols_);
+  }
+  // start modelling branch prediction by specific direction predictor
+  // returns false if name of predictor is invalid
+  bool StartBranchModel(std::string_view predictor);
+  // write branch prediction statistics to file, returns false if failed
+  bool WriteBranchReport(std::string_view file) const {
+    return branch_model_ && branch_model_->WriteReport(file, symbols_);
+  }
+  // start modelling pipeline timing, 'mcycle' will be driven by model
+  void StartTiming();
+  // write CPI breakdown to file, returns false if failed
+  bool WriteTimingReport(std::string_view file) const {
+    return timing_.WriteReport(file);
+  }
+  // start counting instruction mix
+  void StartInstMix() { inst_mix_ = std::make_unique<InstMixStats>(); }
+  // write instruction mix to file in JSON format,
+  // returns false if failed
+  bool WriteInstMix(std::string_view file) const {
+    return inst_mix_ && inst_mix_->WriteJSON(file);
+  }
+  // start collecting trap statistics & interrupt latencies
+  void StartTrapStats() { core_.set_trap_stats(&trap_stats_); }
+  // write trap statistics to file, returns false if failed
+  bool WriteTrapStats(std::string_view file) const {
+    return trap_stats_.WriteReport(file);
+  }
+  // start writing basic-block vectors of every 'interval' retired
+  // instructions to file, returns false if failed
+  bool StartBBV(std::string_view file, std::uint64_t interval);
+  // write the last interval of basic-block vectors and close file,
+  // returns false if failed
+  bool FinishBBV() { return bbv_ && bbv_->Close(); }
+  // start writing execution trace to file, returns false if failed
+  bool StartTrace(std::string_view file);
+  // flush execution trace and close file, returns false if failed
+  bool FinishTrace() { return tracer_.Close(); }
+  // start checking retired instructions against reference commit log
+  // in lockstep, returns false if failed
+  bool StartLockstep(std::string_view file);
+  // print result of lockstep checking, including full state of core
+  // if diverged from reference log
+  void PrintLockstepReport(std::ostream &os);
+  // start publishing performance counters to shared memory segment,
+  // returns false if failed
+  bool StartPerfShm(std::string_view name);
+  // publish the final counters and remove shared memory segment
+  void FinishPerfShm();
+
+  // run until guest halts or writes the marker
+  void Run();
+  // run a single cycle
+  void NextCycle();
+  // clear marker flag, returns true if guest has written the marker
+  bool CheckAndClearMarker() { return gpio_->CheckAndClearMarker(); }
+
+  // save state of the whole machine to snapshot file
+  bool SaveSnapshot(std::string_view file);
+  // restore state of the whole machine from snapshot file
+  // configuration (size of RAM/ROM/flash) must be the same
+  bool LoadSnapshot(std::string_view file);
+  // take an in-process checkpoint of the whole machine
+  // all previous checkpoints will be dropped
+  void Checkpoint();
+  // push a new checkpoint on top of previous checkpoints
+  void PushCheckpoint();
+  // roll back to the 'n'-th latest checkpoint (0 for the last one)
+  // and drop newer checkpoints, returns false if there is none
+  // only pages written since that checkpoint will be restored
+  bool Restore(std::size_t n = 0);
+  // drop the oldest checkpoint
+  void DropOldestCheckpoint();
+
+  // getters
+  // check if guest has halted (or diverged from lockstep reference)
+  bool halted() const { return gpio_->halt() || checker_.diverged(); }
+  // check if diverged from lockstep reference log
+  bool lockstep_diverged() const { return checker_.diverged(); }
+  // emulation core
+  Core &core() { return core_; }
+  // system bus
+  const std::shared_ptr<Bus> &bus() const { return bus_; }
+  // general purpose IO
+  const std::shared_ptr<GPIO> &gpio() const { return gpio_; }
+  // core local interrupt controller
+  const std::shared_ptr<CLINT> &clint() const { return clint_; }
+  // count of checkpoints
+  std::size_t checkpoint_count() const { return checkpoints_.size(); }
+  // symbol table of guest program
+  const SymbolTable &symbols() const { return symbols_; }
+
+ private:
+  // run until guest halts or writes the marker,
+  // with specific instrumentation policy
+  template <typename Instrument>
+  void RunWith(Instrument &instrument);
+  // run a single cycle with specific instrumentation policy
+  template <typename Instrument>
+  void NextCycleWith(Instrument &instrument);
+  // check if the execution loop can continue
+  bool running() const {
+    return !gpio_->halt() && !gpio_->marker() && !checker_.diverged();
+  }
+  // publish performance counters to shared memory segment
+  void PublishPerf();
+  // save state of core & devices (except memories)
+  void SaveStates(SnapshotWriter &writer) const;
+  // restore state of core & devices (except memories)
+  bool LoadStates(SnapshotReader &reader);
+
+  // peripherals
+  std::shared_ptr<ROM> rom_, flash_;
+  std::shared_ptr<RAM> ram_;
+  std::shared_ptr<GPIO> gpio_;
+  std::shared_ptr<CLINT> clint_;
+  // system bus
+  std::shared_ptr<Bus> bus_;
+  // emulation core
+  Core core_;
+  // symbol table of guest program
+  SymbolTable symbols_;
+  // profiler of guest program
+  Profiler profiler_;
+  // call-graph profiler of guest program
+  std::unique_ptr<CallGraphProfiler> call_graph_;
+  // cache model of memory hierarchy
+  CacheModel cache_;
+  // branch prediction model
+  std::unique_ptr<BranchModel> branch_model_;
+  // pipeline timing model
+  TimingModel timing_;
+  // instruction mix statistics (null if disabled)
+  std::unique_ptr<InstMixStats> inst_mix_;
+  // collector of basic-block vectors (null if disabled)
+  std::unique_ptr<BBVCollector> bbv_;
+  // writer of execution trace
+  TraceWriter tracer_;
+  // lockstep checker against reference commit log
+  LockstepChecker checker_;
+  // statistics of traps
+  TrapStats trap_stats_;
+  // writer of performance counters in shared memory
+  PerfShmWriter perf_shm_;
+  // state of core & devices in all checkpoints (the last one is newest)
+  std::deque<std::vector<std::uint8_t>> checkpoints_;
+};
+
+#endif  // RISKY32_MACHINE_MACHINE_H_
@@ -4,16 +4,14 @@
 #include <cctype>
 #include <cstddef>
 
-#include "core/core.h"
-#include "bus/bus.h"
-#include "peripheral/general/gpio.h"
-#include "peripheral/interrupt/clint.h"
-#include "peripheral/storage/ram.h"
-#include "peripheral/storage/rom.h"
+#include "machine/machine.h"
+#include "machine/forksrv.h"
 #include "debugger/debugger.h"
+#include "debugger/gdbstub.h"
 
-#include "define/mmio.h"
 #include "util/argparse.h"
+#include "util/inputlog.h"
+#include "util/selfprof.h"
 #include "version.h"
 
 using namespace std;
@@ -57,10 +55,86 @@ int main(int argc, const char *argv[]) {
   argp.AddOption<bool>("help", "h", "show this message", false);
   argp.AddOption<bool>("version", "v", "show version info", false);
   argp.AddOption<bool>("debug", "d", "enable built-in debugger", false);
+  argp.AddOption<string>("gdb", "g",
+                         "wait for GDB on TCP port ('-' for stdio)", "");
   argp.AddOption<string>("mem", "m", "set memory size (default to '64k')",
                          "64k");
   argp.AddOption<string>("flash", "f", "load another binary file to flash",
                          "");
+  argp.AddOption<string>("symbols", "sym",
+                         "load symbols from ELF file of guest program", "");
+  argp.AddOption<string>("save-snapshot", "ss",
+                         "save snapshot when guest writes the marker", "");
+  argp.AddOption<string>("load-snapshot", "ls",
+                         "restore machine state from snapshot", "");
+  argp.AddOption<int>("repeat", "r",
+                      "rerun N times from the checkpoint taken at marker",
+                      0);
+  argp.AddOption<string>("fork-server", "fs",
+                         "fork a child for each request on Unix socket "
+                         "after marker",
+                         "");
+  argp.AddOption<string>("record", "rec",
+                         "record console input to log file", "");
+  argp.AddOption<string>("replay", "rep",
+                         "replay console input from log file", "");
+  argp.AddOption<string>("profile", "p",
+                         "write execution profile to file at exit", "");
+  argp.AddOption<string>("call-graph", "cg",
+                         "write sampled call stacks (folded) to file "
+                         "at exit",
+                         "");
+  argp.AddOption<int>("sample-period", "sp",
+                      "set sample period of '--call-graph' "
+                      "(default to 1000)",
+                      1000);
+  argp.AddOption<string>("cache", "c",
+                         "model caches and write statistics to file "
+                         "at exit",
+                         "");
+  argp.AddOption<string>("cache-config", "cc",
+                         "set cache levels, e.g. 'l1d:32k:8:64:lru:wb,"
+                         "l2:256k:8:64'",
+                         "default");
+  argp.AddOption<string>("branch", "br",
+                         "model branch prediction and write statistics "
+                         "to file at exit",
+                         "");
+  argp.AddOption<string>("predictor", "bp",
+                         "set branch predictor (static/bimodal/gshare/"
+                         "tage)",
+                         "gshare");
+  argp.AddOption<string>("inst-mix", "im",
+                         "write instruction mix (JSON) to file at exit",
+                         "");
+  argp.AddOption<string>("bbv", "bb",
+                         "write basic-block vectors (SimPoint format) "
+                         "to file",
+                         "");
+  argp.AddOption<int>("bbv-interval", "bi",
+                      "set interval size of '--bbv' "
+                      "(default to 100000000)",
+                      100000000);
+  argp.AddOption<string>("trace", "tr",
+                         "write trace of retired instructions "
+                         "(compressed) to file",
+                         "");
+  argp.AddOption<string>("perf-shm", "ps",
+                         "publish live performance counters to shared "
+                         "memory segment (see 'risky32-top')",
+                         "");
+  argp.AddOption<string>("lockstep", "lk",
+                         "check retired instructions against reference "
+                         "commit log (Spike log or '--trace' output)",
+                         "");
+  argp.AddOption<string>("timing", "tm",
+                         "model pipeline timing and write CPI breakdown "
+                         "to file at exit",
+                         "");
+  argp.AddOption<string>("trap-stats", "ts",
+                         "write trap handler & interrupt latency "
+                         "histograms to file at exit",
+                         "");
 
   // parse argument
   auto ret = argp.Parse(argc, argv);
@@ -84,61 +158,315 @@ int main(int argc, const char *argv[]) {
   size_t mem_size = GetMemSize(argp.GetValue<string>("mem"));
   auto file = argp.GetValue<string>("binary");
   auto flash_file = argp.GetValue<string>("flash");
+  auto symbol_file = argp.GetValue<string>("symbols");
+  auto save_snapshot = argp.GetValue<string>("save-snapshot");
+  auto load_snapshot = argp.GetValue<string>("load-snapshot");
+  auto repeat = argp.GetValue<int>("repeat");
+  auto fork_server = argp.GetValue<string>("fork-server");
+  auto record = argp.GetValue<string>("record");
+  auto replay = argp.GetValue<string>("replay");
+  auto gdb = argp.GetValue<string>("gdb");
+  auto profile = argp.GetValue<string>("profile");
+  auto call_graph = argp.GetValue<string>("call-graph");
+  auto sample_period = argp.GetValue<int>("sample-period");
+  auto cache = argp.GetValue<string>("cache");
+  auto cache_config = argp.GetValue<string>("cache-config");
+  auto branch = argp.GetValue<string>("branch");
+  auto predictor = argp.GetValue<string>("predictor");
+  auto timing = argp.GetValue<string>("timing");
+  auto inst_mix = argp.GetValue<string>("inst-mix");
+  auto trap_stats = argp.GetValue<string>("trap-stats");
+  auto bbv = argp.GetValue<string>("bbv");
+  auto bbv_interval = argp.GetValue<int>("bbv-interval");
+  auto trace = argp.GetValue<string>("trace");
+  auto lockstep = argp.GetValue<string>("lockstep");
+  auto perf_shm = argp.GetValue<string>("perf-shm");
   if (!mem_size || (mem_size & 0b11)) {
     cerr << "error: invalid memory size (" << mem_size << ')' << endl;
     return 1;
   }
+  if (repeat > 0 && argp.GetValue<bool>("debug")) {
+    // debugger takes its own checkpoints for reverse execution
+    cerr << "error: '--repeat' can not be used with debugger" << endl;
+    return 1;
+  }
+  if (!gdb.empty() &&
+      (argp.GetValue<bool>("debug") || !fork_server.empty())) {
+    cerr << "error: '--gdb' can not be used with debugger or "
+            "'--fork-server'" << endl;
+    return 1;
+  }
+  if (!record.empty() && !replay.empty()) {
+    cerr << "error: '--record' can not be used with '--replay'" << endl;
+    return 1;
+  }
+  if ((!record.empty() || !replay.empty()) &&
+      (repeat > 0 || !fork_server.empty())) {
+    // input log describes a single run
+    cerr << "error: '--record'/'--replay' can not be used with "
+            "'--repeat' or '--fork-server'" << endl;
+    return 1;
+  }
+  if (!lockstep.empty() && (repeat > 0 || !fork_server.empty() ||
+                             argp.GetValue<bool>("debug"))) {
+    // reference log describes a single run, reverse execution of
+    // debugger would check re-executed instructions again
+    cerr << "error: '--lockstep' can not be used with '--repeat', "
+            "'--fork-server' or debugger" << endl;
+    return 1;
+  }
+  if ((!profile.empty() || !call_graph.empty() || !cache.empty() ||
+       !branch.empty() || !timing.empty() || !inst_mix.empty() ||
+       !bbv.empty() || !trace.empty() || !perf_shm.empty() ||
+       !trap_stats.empty()) &&
+      !fork_server.empty()) {
+    // all children would write to the same profile
+    cerr << "error: '--profile'/'--call-graph'/'--cache'/'--branch'/"
+            "'--timing'/'--inst-mix'/'--bbv'/'--trace'/'--perf-shm'/"
+            "'--trap-stats' can not be used with '--fork-server'"
+         << endl;
+    return 1;
+  }
+  if ((!profile.empty() || !call_graph.empty() || !cache.empty() ||
+       !branch.empty() || !timing.empty() || !inst_mix.empty() ||
+       !bbv.empty() || !trace.empty() || !trap_stats.empty()) &&
+      argp.GetValue<bool>("debug")) {
+    // reverse execution of debugger would count re-executed
+    // instructions again
+    cerr << "error: '--profile'/'--call-graph'/'--cache'/'--branch'/"
+            "'--timing'/'--inst-mix'/'--bbv'/'--trace'/'--trap-stats' "
+            "can not be used with debugger"
+         << endl;
+    return 1;
+  }
+  if (bbv_interval <= 0) {
+    cerr << "error: invalid BBV interval (" << bbv_interval << ')'
+         << endl;
+    return 1;
+  }
+  if (sample_period <= 0) {
+    cerr << "error: invalid sample period (" << sample_period << ')'
+         << endl;
+    return 1;
+  }
 
-  // create peripherals
-  auto rom = make_shared<ROM>();
-  auto ram = make_shared<RAM>(mem_size);
-  auto gpio = make_shared<GPIO>();
-  auto clint = make_shared<CLINT>();
-  auto flash = make_shared<ROM>();
-  if (!rom->LoadBinary(file)) {
+  // initialize machine
+  Machine machine(mem_size);
+  if (!machine.LoadROM(file)) {
     cerr << "error: failed to load file '" << file << "'" << endl;
     return 1;
   }
-  if (!flash_file.empty() && !flash->LoadBinary(flash_file)) {
+  if (!flash_file.empty() && !machine.LoadFlash(flash_file)) {
     cerr << "error: failed to load file '" << flash_file << "'" << endl;
     return 1;
   }
+  if (!symbol_file.empty() && !machine.LoadSymbols(symbol_file)) {
+    cerr << "error: failed to load symbols from '" << symbol_file << "'"
+         << endl;
+    return 1;
+  }
+  machine.Reset();
+  if (!profile.empty()) machine.StartProfiling();
+  if (!cache.empty() && !machine.EnableCache(cache_config)) {
+    cerr << "error: invalid cache configuration '" << cache_config << "'"
+         << endl;
+    return 1;
+  }
+  if (!timing.empty()) machine.StartTiming();
+  if (!inst_mix.empty()) machine.StartInstMix();
+  if (!trap_stats.empty()) machine.StartTrapStats();
+  if (!bbv.empty() && !machine.StartBBV(bbv, bbv_interval)) {
+    cerr << "error: failed to create file '" << bbv << "'" << endl;
+    return 1;
+  }
+  if (!trace.empty() && !machine.StartTrace(trace)) {
+    cerr << "error: failed to create file '" << trace << "'" << endl;
+    return 1;
+  }
+  if (!perf_shm.empty() && !machine.StartPerfShm(perf_shm)) {
+    cerr << "error: failed to create shared memory '" << perf_shm << "'"
+         << endl;
+    return 1;
+  }
+  if (!lockstep.empty() && !machine.StartLockstep(lockstep)) {
+    cerr << "error: failed to open log '" << lockstep << "'" << endl;
+    return 1;
+  }
+  if (!branch.empty() && !machine.StartBranchModel(predictor)) {
+    cerr << "error: invalid branch predictor '" << predictor << "'"
+         << endl;
+    return 1;
+  }
+  if (!load_snapshot.empty() && !machine.LoadSnapshot(load_snapshot)) {
+    cerr << "error: failed to load snapshot '" << load_snapshot << "'"
+         << endl;
+    return 1;
+  }
+  if (!call_graph.empty()) machine.StartCallGraph(sample_period);
 
-  // initialize system bus
-  auto bus = make_shared<Bus>();
-  bus->AddPeripheral(kMMIOAddrROM, rom);
-  bus->AddPeripheral(kMMIOAddrRAM, ram);
-  bus->AddPeripheral(kMMIOAddrGPIO, gpio);
-  bus->AddPeripheral(kMMIOAddrCLINT, clint);
-  if (flash->size()) {
-    bus->AddPeripheral(kMMIOAddrFlash, flash);
+  // initialize input log
+  InputLogWriter recorder;
+  InputLogReader replayer;
+  if (!record.empty()) {
+    if (!recorder.Open(record)) {
+      cerr << "error: failed to create log '" << record << "'" << endl;
+      return 1;
+    }
+    machine.gpio()->set_recorder(&recorder);
+  }
+  if (!replay.empty()) {
+    if (!replayer.Open(replay)) {
+      cerr << "error: failed to open log '" << replay << "'" << endl;
+      return 1;
+    }
+    machine.gpio()->set_replayer(&replayer);
   }
 
-  // initialize core
-  Core core(bus);
-  core.set_timer_int(clint->timer_int());
-  core.set_soft_int(clint->soft_int());
-  core.Reset();
+  // initialize fork server
+  ForkServer server(machine);
+  if (!fork_server.empty() && !server.Listen(fork_server)) {
+    cerr << "error: failed to listen on '" << fork_server << "'" << endl;
+    return 1;
+  }
+  // start serving immediately if machine is restored from snapshot
+  // only child processes will continue running
+  if (!fork_server.empty() && !load_snapshot.empty()) {
+    if (!server.Serve()) {
+      cerr << "error: fork server failed" << endl;
+      return 1;
+    }
+    fork_server.clear();
+  }
 
+  // initialize debugger
+  shared_ptr<Debugger> debugger;
   if (argp.GetValue<bool>("debug")) {
     PrintVersion();
     cout << endl;
-    // run debugger
-    auto debugger = make_shared<Debugger>(core);
-    bus->AddPeripheral(kMMIOAddrDebugger, debugger);
-    while (!gpio->halt()) {
-      clint->UpdateTimer();
-      debugger->NextCycle();
+    debugger = make_shared<Debugger>(machine);
+  }
+
+  // initialize GDB stub
+  GDBStub gdb_stub(machine);
+  if (!gdb.empty()) {
+    if (gdb != "-") cerr << "waiting for GDB on port " << gdb << endl;
+    if (!gdb_stub.Connect(gdb)) {
+      cerr << "error: failed to connect to GDB" << endl;
+      return 1;
     }
   }
-  else {
-    // run emulation
-    while (!gpio->halt()) {
-      clint->UpdateTimer();
-      core.NextCycle();
+
+  // run emulation
+  auto killed = false;
+  for (;;) {
+    if (debugger) {
+      debugger->NextCycle();
+    }
+    else if (!gdb.empty()) {
+      // stop emulation if GDB has killed the machine
+      if (!gdb_stub.Run()) {
+        killed = true;
+        break;
+      }
+    }
+    else {
+      machine.Run();
+    }
+    // check if guest has written the marker
+    if (machine.CheckAndClearMarker()) {
+      if (!save_snapshot.empty() && !machine.SaveSnapshot(save_snapshot)) {
+        cerr << "error: failed to save snapshot '" << save_snapshot << "'"
+             << endl;
+        return 1;
+      }
+      if (repeat > 0) machine.Checkpoint();
+      // start serving, only child processes will continue running
+      if (!fork_server.empty()) {
+        if (!server.Serve()) {
+          cerr << "error: fork server failed" << endl;
+          return 1;
+        }
+        fork_server.clear();
+      }
     }
+    // check if need to rerun from checkpoint
+    if (machine.halted()) {
+      if (repeat <= 0 || !machine.Restore()) break;
+      --repeat;
+    }
+  }
+  // publish the final performance counters
+  machine.FinishPerfShm();
+
+#ifdef RISKY32_SELF_PROFILE
+  // print time breakdown of emulator
+  SelfProfileTimer::PrintReport(cerr);
+#endif
+
+  // check input log
+  if (!recorder.Close()) {
+    cerr << "error: failed to write log '" << record << "'" << endl;
+    return 1;
+  }
+  if (!replayer.Finish()) {
+    cerr << "error: replay diverged from log '" << replay << "'" << endl;
+    return 1;
+  }
+  if (!lockstep.empty()) {
+    machine.PrintLockstepReport(cerr);
+    if (machine.lockstep_diverged()) return 1;
+  }
+
+  // write profile
+  if (!profile.empty() && !machine.WriteProfile(profile)) {
+    cerr << "error: failed to write profile '" << profile << "'" << endl;
+    return 1;
+  }
+  if (!call_graph.empty() && !machine.WriteCallGraph(call_graph)) {
+    cerr << "error: failed to write call graph '" << call_graph << "'"
+         << endl;
+    return 1;
+  }
+  if (!cache.empty() && !machine.WriteCacheReport(cache)) {
+    cerr << "error: failed to write cache report '" << cache << "'"
+         << endl;
+    return 1;
+  }
+  if (!branch.empty() && !machine.WriteBranchReport(branch)) {
+    cerr << "error: failed to write branch report '" << branch << "'"
+         << endl;
+    return 1;
+  }
+  if (!timing.empty() && !machine.WriteTimingReport(timing)) {
+    cerr << "error: failed to write timing report '" << timing << "'"
+         << endl;
+    return 1;
+  }
+  if (!inst_mix.empty() && !machine.WriteInstMix(inst_mix)) {
+    cerr << "error: failed to write instruction mix '" << inst_mix << "'"
+         << endl;
+    return 1;
+  }
+  if (!trap_stats.empty() && !machine.WriteTrapStats(trap_stats)) {
+    cerr << "error: failed to write trap statistics '" << trap_stats
+         << "'" << endl;
+    return 1;
+  }
+  if (!trace.empty() && !machine.FinishTrace()) {
+    cerr << "error: failed to write trace '" << trace << "'" << endl;
+    return 1;
+  }
+  if (!bbv.empty() && !machine.FinishBBV()) {
+    cerr << "error: failed to write basic-block vectors '" << bbv << "'"
+         << endl;
+    return 1;
   }
 
   // return the value of register 'a0' as exit code
-  return core.regs(10);
+  // or exit successfully if killed by GDB
+  if (killed) return 0;
+  auto exit_code = machine.core().regs(10);
+  server.Finish(exit_code);
+  gdb_stub.Finish(exit_code);
+  return exit_code;
 }
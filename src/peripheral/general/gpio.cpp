@@ -1,18 +1,78 @@
 #include "peripheral/general/gpio.h"
 
 #include <cstdio>
+#include <cassert>
 
 namespace {
 
 constexpr std::uint32_t kAddrHaltFlag   = 0x100;
 constexpr std::uint32_t kAddrConsoleIO  = 0x104;
+constexpr std::uint32_t kAddrMarker     = 0x108;
 
 }  // namespace
 
+void GPIO::SaveState(SnapshotWriter &writer) const {
+  writer.BeginSection("GPIO");
+  writer.Write(halt_);
+  writer.Write(input_pos_);
+  writer.Write(output_pos_);
+}
+
+bool GPIO::LoadState(SnapshotReader &reader) {
+  if (!reader.CheckSection("GPIO") || !reader.Read(halt_) ||
+      !reader.Read(input_pos_) || !reader.Read(output_pos_)) {
+    return false;
+  }
+  // positions beyond history (e.g. loaded from snapshot file)
+  // are treated as the end of history
+  if (input_pos_ > input_history_.size()) {
+    input_pos_ = input_history_.size();
+  }
+  return true;
+}
+
+std::uint8_t GPIO::ReadConsole() {
+  ++input_bytes_;
+  if (!keep_history_) return ReadInput();
+  // read from history if possible
+  if (input_pos_ < input_history_.size()) {
+    return input_history_[input_pos_++];
+  }
+  auto value = ReadInput();
+  input_history_.push_back(value);
+  ++input_pos_;
+  return value;
+}
+
+std::uint8_t GPIO::ReadInput() {
+  assert(!(recorder_ || replayer_) || retired_count_);
+  if (replayer_) {
+    std::uint64_t value;
+    if (!replayer_->Read(*retired_count_, value)) {
+      // replay diverged from log, stop emulation
+      halt_ = true;
+      return 0xff;
+    }
+    return value;
+  }
+  std::uint8_t value = std::fgetc(input_);
+  if (recorder_) recorder_->Write(*retired_count_, value);
+  return value;
+}
+
+void GPIO::WriteConsole(std::uint8_t value) {
+  ++output_bytes_;
+  // skip output that has already been printed
+  if (!keep_history_ || output_pos_++ >= output_max_) {
+    std::fputc(value, output_);
+    output_max_ = output_pos_;
+  }
+}
+
 std::uint8_t GPIO::ReadByte(std::uint32_t addr) {
   switch (addr) {
     case kAddrHaltFlag: return halt_;
-    case kAddrConsoleIO: return std::getchar();
+    case kAddrConsoleIO: return ReadConsole();
     default: return 0;
   }
 }
@@ -20,7 +80,8 @@ std::uint8_t GPIO::ReadByte(std::uint32_t addr) {
 void GPIO::WriteByte(std::uint32_t addr, std::uint8_t value) {
   switch (addr) {
     case kAddrHaltFlag: halt_ = value; break;
-    case kAddrConsoleIO: std::fputc(value, stderr); break;
+    case kAddrConsoleIO: WriteConsole(value); break;
+    case kAddrMarker: marker_ = true; break;
     default:;
   }
 }
@@ -1,11 +1,32 @@
 #ifndef RISKY32_PERIPHERAL_GENERAL_GPIO_H_
 #define RISKY32_PERIPHERAL_GENERAL_GPIO_H_
 
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+
 #include "peripheral/peripheral.h"
+#include "util/snapshot.h"
+#include "util/inputlog.h"
 
 class GPIO : public PeripheralInterface {
  public:
-  GPIO() : halt_(false) {}
+  GPIO()
+      : halt_(false), marker_(false), input_(stdin), output_(stderr),
+        keep_history_(false), input_pos_(0), output_pos_(0),
+        output_max_(0), input_bytes_(0), output_bytes_(0),
+        retired_count_(nullptr), recorder_(nullptr), replayer_(nullptr) {}
+
+  // save state to snapshot
+  void SaveState(SnapshotWriter &writer) const;
+  // restore state from snapshot, returns false if failed
+  bool LoadState(SnapshotReader &reader);
+  // clear marker flag, returns true if marker has been written
+  bool CheckAndClearMarker() {
+    auto marker = marker_;
+    marker_ = false;
+    return marker;
+  }
 
   std::uint8_t ReadByte(std::uint32_t addr) override;
   void WriteByte(std::uint32_t addr, std::uint8_t value) override;
@@ -15,12 +36,63 @@ class GPIO : public PeripheralInterface {
   void WriteWord(std::uint32_t addr, std::uint32_t value) override;
   std::uint32_t size() const override { return 512; }
 
+  // setters
+  // input stream of console
+  void set_input(std::FILE *input) { input_ = input; }
+  // output stream of console
+  void set_output(std::FILE *output) { output_ = output; }
+  // keep history of console, so that re-executing from a restored state
+  // reads the same input and does not print the same output again
+  void set_keep_history(bool keep_history) {
+    keep_history_ = keep_history;
+  }
+  // retired instruction count of core (used to tag logged inputs)
+  void set_retired_count(const std::uint64_t *retired_count) {
+    retired_count_ = retired_count;
+  }
+  // record console input to log
+  void set_recorder(InputLogWriter *recorder) { recorder_ = recorder; }
+  // read console input from log instead of input stream
+  void set_replayer(InputLogReader *replayer) { replayer_ = replayer; }
+
   // getters
   bool halt() const { return halt_; }
+  // marker flag (written by guest to notify the host, e.g. boot done)
+  bool marker() const { return marker_; }
+  // total bytes read from/written to console
+  // (including re-executed accesses)
+  std::uint64_t input_bytes() const { return input_bytes_; }
+  std::uint64_t output_bytes() const { return output_bytes_; }
 
  private:
+  // read a byte from console
+  std::uint8_t ReadConsole();
+  // read a byte from input stream or log
+  std::uint8_t ReadInput();
+  // write a byte to console
+  void WriteConsole(std::uint8_t value);
+
   // halt flag
   bool halt_;
+  // marker flag
+  bool marker_;
+  // input & output stream of console
+  std::FILE *input_, *output_;
+  // keep history of console
+  bool keep_history_;
+  // history of console input
+  std::vector<std::uint8_t> input_history_;
+  // count of bytes read from/written to console
+  std::uint64_t input_pos_, output_pos_;
+  // max count of bytes written to console
+  std::uint64_t output_max_;
+  // total bytes read from/written to console
+  std::uint64_t input_bytes_, output_bytes_;
+  // retired instruction count of core
+  const std::uint64_t *retired_count_;
+  // input log recorder & replayer
+  InputLogWriter *recorder_;
+  InputLogReader *replayer_;
 };
 
 #endif  // RISKY32_PERIPHERAL_GENERAL_GPIO_H_
@@ -65,6 +65,20 @@ void CLINT::WriteWord(std::uint32_t addr, std::uint32_t value) {
   }
 }
 
+void CLINT::SaveState(SnapshotWriter &writer) const {
+  writer.BeginSection("CLNT");
+  writer.Write(timer_int_);
+  writer.Write(soft_int_);
+  writer.Write(mtime_);
+  writer.Write(mtimecmp_);
+}
+
+bool CLINT::LoadState(SnapshotReader &reader) {
+  return reader.CheckSection("CLNT") && reader.Read(timer_int_) &&
+         reader.Read(soft_int_) && reader.Read(mtime_) &&
+         reader.Read(mtimecmp_);
+}
+
 void CLINT::UpdateTimer() {
   ++mtime_;
   timer_int_ = mtime_ >= mtimecmp_;
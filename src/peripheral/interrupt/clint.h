@@ -4,6 +4,7 @@
 #include <cstdint>
 
 #include "peripheral/peripheral.h"
+#include "util/snapshot.h"
 
 // core local interrupt controller
 // generates M-mode timer interrupt & software interrupt
@@ -21,6 +22,10 @@ class CLINT : public PeripheralInterface {
 
   // update timer register
   void UpdateTimer();
+  // save state to snapshot
+  void SaveState(SnapshotWriter &writer) const;
+  // restore state from snapshot, returns false if failed
+  bool LoadState(SnapshotReader &reader);
 
   // getters
   // timer interrupt signal
@@ -0,0 +1,69 @@
+#include "peripheral/storage/journal.h"
+
+#include <cstring>
+#include <cassert>
+
+void PageJournal::Checkpoint(std::uint8_t *base, std::size_t size) {
+  base_ = base;
+  size_ = size;
+  epochs_.clear();
+  // 0 is never used as an epoch id
+  next_id_ = 1;
+  stamps_.assign((size + kPageSize - 1) >> kPageShift, 0);
+  PushEpoch();
+}
+
+void PageJournal::PushEpoch() {
+  if (!base_) return;
+  epochs_.push_back({next_id_++, {}, {}});
+}
+
+void PageJournal::Restore(std::size_t n) {
+  if (!base_) return;
+  assert(n < epochs_.size());
+  // roll back & drop newer epochs
+  for (std::size_t i = 0; i < n; ++i) {
+    RollBack(epochs_.back());
+    epochs_.pop_back();
+  }
+  // roll back current epoch, and restart it with a new id
+  // so that all pages will be saved again on their first write
+  auto &cur = epochs_.back();
+  RollBack(cur);
+  cur.id = next_id_++;
+  cur.pages.clear();
+  cur.backup.clear();
+}
+
+void PageJournal::DropOldest() {
+  // current epoch can not be dropped
+  if (epochs_.size() > 1) epochs_.pop_front();
+}
+
+void PageJournal::Discard() {
+  base_ = nullptr;
+  size_ = 0;
+  stamps_.clear();
+  epochs_.clear();
+}
+
+void PageJournal::SavePage(std::uint32_t page) {
+  auto &cur = epochs_.back();
+  auto offset = static_cast<std::size_t>(page) << kPageShift;
+  auto len = size_ - offset < kPageSize ? size_ - offset : kPageSize;
+  // append original contents to backup
+  auto pos = cur.backup.size();
+  cur.backup.resize(pos + kPageSize);
+  std::memcpy(cur.backup.data() + pos, base_ + offset, len);
+  // mark as saved in current epoch
+  stamps_[page] = cur.id;
+  cur.pages.push_back(page);
+}
+
+void PageJournal::RollBack(const Epoch &epoch) {
+  for (std::size_t i = 0; i < epoch.pages.size(); ++i) {
+    auto offset = static_cast<std::size_t>(epoch.pages[i]) << kPageShift;
+    auto len = size_ - offset < kPageSize ? size_ - offset : kPageSize;
+    std::memcpy(base_ + offset, epoch.backup.data() + i * kPageSize, len);
+  }
+}
@@ -0,0 +1,75 @@
+#ifndef RISKY32_PERIPHERAL_STORAGE_JOURNAL_H_
+#define RISKY32_PERIPHERAL_STORAGE_JOURNAL_H_
+
+#include <vector>
+#include <deque>
+#include <cstdint>
+#include <cstddef>
+
+// page-granular undo journal of memory
+// saves original contents of each page on its first write in every
+// epoch (the period between two checkpoints), so that restoring costs
+// time proportional to the number of touched pages, rather than the
+// size of memory
+class PageJournal {
+ public:
+  PageJournal() : base_(nullptr), size_(0), next_id_(0) {}
+
+  // start journaling from current contents of specific memory
+  // all existing epochs will be dropped
+  void Checkpoint(std::uint8_t *base, std::size_t size);
+  // start a new epoch on top of existing epochs
+  void PushEpoch();
+  // roll back to the beginning of the 'n'-th latest epoch
+  // (0 for current epoch), newer epochs will be dropped
+  // journal will still be active after restoring
+  void Restore(std::size_t n);
+  // drop the oldest epoch
+  void DropOldest();
+  // stop journaling and drop all saved pages
+  void Discard();
+
+  // record a write operation at specific address (offset of memory)
+  void Touch(std::uint32_t addr) {
+    auto page = addr >> kPageShift;
+    if (base_ && stamps_[page] != epochs_.back().id) SavePage(page);
+  }
+
+  // getters
+  // check if journal is active
+  bool active() const { return base_; }
+  // count of epochs
+  std::size_t epoch_count() const { return epochs_.size(); }
+
+ private:
+  // size of journal page
+  static const std::size_t kPageShift = 12;
+  static const std::size_t kPageSize = 1 << kPageShift;
+
+  // pages saved in an epoch
+  struct Epoch {
+    // unique id of epoch
+    std::uint32_t id;
+    // list of dirty pages
+    std::vector<std::uint32_t> pages;
+    // original contents of dirty pages
+    std::vector<std::uint8_t> backup;
+  };
+
+  // save original contents of specific page
+  void SavePage(std::uint32_t page);
+  // roll back all pages saved in specific epoch
+  void RollBack(const Epoch &epoch);
+
+  // base address & size of memory
+  std::uint8_t *base_;
+  std::size_t size_;
+  // id of epoch in which each page was last saved
+  std::vector<std::uint32_t> stamps_;
+  // all epochs (the last one is current)
+  std::deque<Epoch> epochs_;
+  // next epoch id
+  std::uint32_t next_id_;
+};
+
+#endif  // RISKY32_PERIPHERAL_STORAGE_JOURNAL_H_
@@ -1,9 +1,48 @@
 #include "peripheral/storage/ram.h"
 
+#include <cstring>
 #include <cassert>
 
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+
+// get length of mapping that can hold 'size' bytes
+inline std::size_t GetMapLength(std::size_t size) {
+  static const std::size_t page_size = sysconf(_SC_PAGESIZE);
+  return (size + page_size - 1) & ~(page_size - 1);
+}
+
+}  // namespace
+
+RAM::~RAM() {
+  if (ram_) munmap(ram_, GetMapLength(size_));
+}
+
 void RAM::Reset() {
-  for (auto &&i : ram_) i = 0;
+  journal_.Discard();
+  std::memset(ram_, 0, size_);
+}
+
+void RAM::SaveState(SnapshotWriter &writer) const {
+  writer.BeginSection("RAM");
+  writer.Write(static_cast<std::uint64_t>(size_));
+  writer.WritePages(ram_, size_);
+}
+
+bool RAM::LoadState(SnapshotReader &reader) {
+  std::uint64_t size;
+  if (!reader.CheckSection("RAM") || !reader.Read(size)) return false;
+  // size of RAM must match
+  if (size != size_) return false;
+  // contents will be replaced, drop the checkpoint
+  journal_.Discard();
+  return reader.ReadPages(ram_, size_, true);
+}
+
+void RAM::Checkpoint() {
+  journal_.Checkpoint(ram_, size_);
 }
 
 std::uint8_t RAM::ReadByte(std::uint32_t addr) {
@@ -11,6 +50,7 @@ std::uint8_t RAM::ReadByte(std::uint32_t addr) {
 }
 
 void RAM::WriteByte(std::uint32_t addr, std::uint8_t value) {
+  journal_.Touch(addr);
   ram_[addr] = value;
 }
 
@@ -22,6 +62,7 @@ std::uint16_t RAM::ReadHalf(std::uint32_t addr) {
 
 void RAM::WriteHalf(std::uint32_t addr, std::uint16_t value) {
   assert((addr & 1) == 0);
+  journal_.Touch(addr);
   ram_[addr] = value & 0xff;
   ram_[addr + 1] = value >> 8;
 }
@@ -35,8 +76,25 @@ std::uint32_t RAM::ReadWord(std::uint32_t addr) {
 
 void RAM::WriteWord(std::uint32_t addr, std::uint32_t value) {
   assert((addr & 3) == 0);
+  journal_.Touch(addr);
   ram_[addr] = value & 0xff;
   ram_[addr + 1] = (value >> 8) & 0xff;
   ram_[addr + 2] = (value >> 16) & 0xff;
   ram_[addr + 3] = value >> 24;
 }
+
+void RAM::set_size(std::size_t size) {
+  // allocate new buffer
+  auto ram = static_cast<std::uint8_t *>(
+      mmap(nullptr, GetMapLength(size), PROT_READ | PROT_WRITE,
+           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+  assert(ram != MAP_FAILED);
+  // copy & release old buffer
+  if (ram_) {
+    std::memcpy(ram, ram_, size < size_ ? size : size_);
+    munmap(ram_, GetMapLength(size_));
+  }
+  ram_ = ram;
+  size_ = size;
+  journal_.Discard();
+}
@@ -1,18 +1,34 @@
 #ifndef RISKY32_PERIPHERAL_STORAGE_RAM_H_
 #define RISKY32_PERIPHERAL_STORAGE_RAM_H_
 
-#include <vector>
+#include <cstdint>
 #include <cstddef>
 
 #include "peripheral/peripheral.h"
+#include "peripheral/storage/journal.h"
+#include "util/snapshot.h"
 
 class RAM : public PeripheralInterface {
  public:
-  RAM() { ram_.resize(16384); }
-  RAM(std::size_t size) { ram_.resize(size); }
+  RAM() : RAM(16384) {}
+  RAM(std::size_t size) : ram_(nullptr), size_(0) { set_size(size); }
+  ~RAM();
 
   // reset all bytes in RAM to zero
   void Reset();
+  // save contents to snapshot
+  void SaveState(SnapshotWriter &writer) const;
+  // restore contents from snapshot, returns false if failed
+  bool LoadState(SnapshotReader &reader);
+  // take an in-process checkpoint of current contents
+  // all previous checkpoints will be dropped
+  void Checkpoint();
+  // push a new checkpoint on top of previous checkpoints
+  void PushCheckpoint() { journal_.PushEpoch(); }
+  // roll back contents to the 'n'-th latest checkpoint
+  void Restore(std::size_t n) { journal_.Restore(n); }
+  // drop the oldest checkpoint
+  void DropOldestCheckpoint() { journal_.DropOldest(); }
 
   std::uint8_t ReadByte(std::uint32_t addr) override;
   void WriteByte(std::uint32_t addr, std::uint8_t value) override;
@@ -20,14 +36,18 @@ class RAM : public PeripheralInterface {
   void WriteHalf(std::uint32_t addr, std::uint16_t value) override;
   std::uint32_t ReadWord(std::uint32_t addr) override;
   void WriteWord(std::uint32_t addr, std::uint32_t value) override;
-  std::uint32_t size() const override { return ram_.size(); }
+  std::uint32_t size() const override { return size_; }
 
   // setters
   // reset the size of the RAM
-  void set_size(std::size_t size) { ram_.resize(size); }
+  void set_size(std::size_t size);
 
  private:
-  std::vector<std::uint8_t> ram_;
+  // RAM buffer (page aligned anonymous mapping)
+  std::uint8_t *ram_;
+  std::size_t size_;
+  // undo journal for checkpoints
+  PageJournal journal_;
 };
 
 #endif  // RISKY32_PERIPHERAL_STORAGE_RAM_H_
@@ -17,14 +17,15 @@ inline std::uint8_t HexConvert(char c) {
 
 bool ROM::LoadBinary(std::string_view file) {
   // open file
-  std::ifstream ifs(file, std::ios::binary);
+  std::ifstream ifs(std::string{file}, std::ios::binary);
   if (!ifs.is_open()) return false;
   // initialize file stream and byte array
   ifs >> std::noskipws;
+  journal_.Discard();
   rom_.clear();
   // read bytes
-  unsigned int cur_byte = ifs.get();
-  while (cur_byte != std::char_traits<unsigned char>::eof()) {
+  auto cur_byte = ifs.get();
+  while (cur_byte != std::ifstream::traits_type::eof()) {
     rom_.push_back(static_cast<std::uint8_t>(cur_byte));
     cur_byte = ifs.get();
   }
@@ -33,8 +34,9 @@ bool ROM::LoadBinary(std::string_view file) {
 
 bool ROM::LoadHex(std::string_view file) {
   // open file
-  std::ifstream ifs(file);
+  std::ifstream ifs(std::string{file});
   if (!ifs.is_open()) return false;
+  journal_.Discard();
   rom_.clear();
   // read current hex
   std::string hex;
@@ -46,11 +48,32 @@ bool ROM::LoadHex(std::string_view file) {
   return true;
 }
 
+void ROM::SaveState(SnapshotWriter &writer) const {
+  writer.BeginSection("ROM");
+  writer.Write(static_cast<std::uint64_t>(rom_.size()));
+  writer.WriteData(rom_.data(), rom_.size());
+}
+
+bool ROM::LoadState(SnapshotReader &reader) {
+  std::uint64_t size;
+  if (!reader.CheckSection("ROM") || !reader.Read(size)) return false;
+  // size of ROM must match
+  if (size != rom_.size()) return false;
+  // contents will be replaced, drop the checkpoint
+  journal_.Discard();
+  return reader.ReadData(rom_.data(), rom_.size());
+}
+
+void ROM::Checkpoint() {
+  journal_.Checkpoint(rom_.data(), rom_.size());
+}
+
 std::uint8_t ROM::ReadByte(std::uint32_t addr) {
   return rom_[addr];
 }
 
 void ROM::WriteByte(std::uint32_t addr, std::uint8_t value) {
+  journal_.Touch(addr);
   rom_[addr] = value;
 }
 
@@ -62,6 +85,7 @@ std::uint16_t ROM::ReadHalf(std::uint32_t addr) {
 
 void ROM::WriteHalf(std::uint32_t addr, std::uint16_t value) {
   assert((addr & 1) == 0);
+  journal_.Touch(addr);
   rom_[addr] = value & 0xff;
   rom_[addr + 1] = value >> 8;
 }
@@ -75,6 +99,7 @@ std::uint32_t ROM::ReadWord(std::uint32_t addr) {
 
 void ROM::WriteWord(std::uint32_t addr, std::uint32_t value) {
   assert((addr & 3) == 0);
+  journal_.Touch(addr);
   rom_[addr] = value & 0xff;
   rom_[addr + 1] = (value >> 8) & 0xff;
   rom_[addr + 2] = (value >> 16) & 0xff;
@@ -3,8 +3,11 @@
 
 #include <string_view>
 #include <vector>
+#include <cstddef>
 
 #include "peripheral/peripheral.h"
+#include "peripheral/storage/journal.h"
+#include "util/snapshot.h"
 
 class ROM : public PeripheralInterface {
  public:
@@ -14,6 +17,19 @@ class ROM : public PeripheralInterface {
   bool LoadBinary(std::string_view file);
   // load hexadecimal byte file to ROM
   bool LoadHex(std::string_view file);
+  // save contents to snapshot
+  void SaveState(SnapshotWriter &writer) const;
+  // restore contents from snapshot, returns false if failed
+  bool LoadState(SnapshotReader &reader);
+  // take an in-process checkpoint of current contents
+  // all previous checkpoints will be dropped
+  void Checkpoint();
+  // push a new checkpoint on top of previous checkpoints
+  void PushCheckpoint() { journal_.PushEpoch(); }
+  // roll back contents to the 'n'-th latest checkpoint
+  void Restore(std::size_t n) { journal_.Restore(n); }
+  // drop the oldest checkpoint
+  void DropOldestCheckpoint() { journal_.DropOldest(); }
 
   std::uint8_t ReadByte(std::uint32_t addr) override;
   void WriteByte(std::uint32_t addr, std::uint8_t value) override;
@@ -25,6 +41,8 @@ class ROM : public PeripheralInterface {
 
  private:
   std::vector<std::uint8_t> rom_;
+  // undo journal for checkpoints
+  PageJournal journal_;
 };
 
 #endif  // RISKY32_PERIPHERAL_STORAGE_ROM_H_
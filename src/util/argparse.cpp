@@ -70,7 +70,11 @@ bool ArgParser::Parse(int argc, const char *argv[]) {
         // read argument of option
         ++i;
         if (i >= argc) return false;
-        if (argv[i][0] == '-' || !ReadArgValue(argv[i], val)) return false;
+        // a single '-' is a valid value (e.g. stdin/stdout)
+        if ((argv[i][0] == '-' && argv[i][1]) ||
+            !ReadArgValue(argv[i], val)) {
+          return false;
+        }
       }
     }
     else {
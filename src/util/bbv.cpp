@@ -0,0 +1,56 @@
+#include "util/bbv.h"
+
+#include <algorithm>
+#include <string>
+#include <cassert>
+#include <cinttypes>
+
+bool BBVCollector::Open(std::string_view file) {
+  assert(interval_);
+  Close();
+  file_ = std::fopen(std::string(file).c_str(), "w");
+  if (!file_) return false;
+  failed_ = false;
+  return true;
+}
+
+bool BBVCollector::Close() {
+  if (!file_) return !failed_;
+  // write the last interval
+  if (interval_left_ != interval_) EndInterval();
+  if (std::fclose(file_)) failed_ = true;
+  file_ = nullptr;
+  return !failed_;
+}
+
+void BBVCollector::EndBlock() {
+  // get id of block, look up in cache first
+  auto &slot = id_cache_[(block_start_ >> 2) & (kIdCacheSize - 1)];
+  if (slot.first != block_start_) {
+    auto [it, inserted] = block_ids_.insert(
+        {block_start_, static_cast<std::uint32_t>(counts_.size())});
+    if (inserted) counts_.push_back(0);
+    slot = *it;
+  }
+  auto &count = counts_[slot.second];
+  if (!count) touched_.push_back(slot.second);
+  count += block_len_;
+  block_len_ = 0;
+}
+
+void BBVCollector::EndInterval() {
+  if (block_len_) EndBlock();
+  interval_left_ = interval_;
+  // write counts of all executed blocks, sorted by id
+  std::sort(touched_.begin(), touched_.end());
+  if (file_ && std::fputc('T', file_) == EOF) failed_ = true;
+  for (const auto &id : touched_) {
+    if (file_ && std::fprintf(file_, ":%" PRIu32 ":%" PRIu64 " ", id + 1,
+                              counts_[id]) < 0) {
+      failed_ = true;
+    }
+    counts_[id] = 0;
+  }
+  touched_.clear();
+  if (file_ && std::fputc('\n', file_) == EOF) failed_ = true;
+}
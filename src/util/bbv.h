@@ -0,0 +1,85 @@
+#ifndef RISKY32_UTIL_BBV_H_
+#define RISKY32_UTIL_BBV_H_
+
+#include <string_view>
+#include <vector>
+#include <array>
+#include <unordered_map>
+#include <utility>
+#include <cstdio>
+#include <cstdint>
+#include <cstddef>
+
+#include "define/inst.h"
+
+// collector of basic-block vectors (BBV) for SimPoint-style sampling
+// retired instructions are split into fixed-size intervals, and the
+// instruction count of each basic block in each interval is written
+// in SimPoint '.bb' format ('T:id:count :id:count ...', one line per
+// interval, ids start from 1)
+// basic blocks end at jumps, branches, system instructions, traps and
+// interval boundaries, and are identified by their start addresses,
+// so that only one lookup is performed for each executed block
+// used as an instrumentation policy of the execution loop
+// (see 'Core::NextCycle')
+class BBVCollector {
+ public:
+  BBVCollector(std::uint64_t interval)
+      : file_(nullptr), failed_(false), interval_(interval),
+        interval_left_(interval), block_start_(0), block_len_(0) {
+    id_cache_.fill({kInvalidAddr, 0});
+  }
+  ~BBVCollector() { Close(); }
+
+  // create output file, returns false if failed
+  bool Open(std::string_view file);
+  // write the last (incomplete) interval & close output file,
+  // returns false if any error occurred
+  bool Close();
+
+  // handle a retired instruction
+  void Retire(std::uint32_t pc, std::uint32_t inst_data,
+              std::uint32_t next_pc, std::uint32_t priv) {
+    if (!block_len_++) block_start_ = pc;
+    auto opcode = inst_data & 0x7f;
+    if (opcode == kBranch || opcode == kJAL || opcode == kJALR ||
+        opcode == kSystem) {
+      EndBlock();
+    }
+    if (!--interval_left_) EndInterval();
+  }
+  // handle a trap
+  void Trap(std::uint32_t priv) {
+    if (block_len_) EndBlock();
+  }
+
+ private:
+  // size of block id cache
+  static constexpr std::size_t kIdCacheSize = 256;
+  // address that never starts a block (not aligned)
+  static constexpr std::uint32_t kInvalidAddr = 1;
+
+  // count the current block
+  void EndBlock();
+  // write the current interval
+  void EndInterval();
+
+  // output file
+  std::FILE *file_;
+  bool failed_;
+  // interval size & instructions left in current interval
+  std::uint64_t interval_, interval_left_;
+  // start address & instruction count of current block
+  std::uint32_t block_start_, block_len_;
+  // map of start addresses of blocks to ids
+  std::unordered_map<std::uint32_t, std::uint32_t> block_ids_;
+  // direct-mapped cache of 'block_ids_' (start address, id)
+  std::array<std::pair<std::uint32_t, std::uint32_t>, kIdCacheSize>
+      id_cache_;
+  // instruction counts of blocks in current interval (indexed by id)
+  std::vector<std::uint64_t> counts_;
+  // ids of blocks executed in current interval
+  std::vector<std::uint32_t> touched_;
+};
+
+#endif  // RISKY32_UTIL_BBV_H_
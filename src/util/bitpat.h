@@ -3,13 +3,9 @@
 
 #include <type_traits>
 #include <string_view>
-#include <unordered_map>
-#include <memory>
-#include <variant>
+#include <array>
 #include <optional>
 #include <utility>
-#include <initializer_list>
-#include <vector>
 #include <cstdint>
 #include <cstddef>
 #include <cassert>
@@ -21,6 +17,7 @@ class BitPat {
  public:
   static_assert(std::is_integral<T>::value);
 
+  constexpr BitPat() : value_(0), mask_(0) {}
   constexpr BitPat(T value, T mask) : value_(value), mask_(mask) {}
   constexpr BitPat(T value) : value_(value), mask_(-1) {}
   constexpr BitPat(std::string_view s)
@@ -66,120 +63,269 @@ using BitPat32 = BitPat<std::uint32_t>;
 
 
 // tool for bitwise pattern matching
-template <typename T, typename Val>
+// decision tree is built at compile time and laid out as flat arrays:
+// each node selects some bits of value by its mask, looks up the
+// masked value in its entries (indexed directly if the selected bits
+// are narrow enough, or searched by key), and then goes to a value,
+// a sub-node, or a single rule to be checked, values of rules with
+// empty mask are used as default
+// 'kMaxEntries' limits size of entry array, building fails ('valid()'
+// returns false) if it is too small for rules
+template <typename T, typename Val, std::size_t N,
+          std::size_t kMaxEntries = N * 8>
 class BitMatch {
  public:
   static_assert(std::is_integral<T>::value);
+  static_assert(N > 0 && N < 0xffff);
 
   using InitPair = std::pair<BitPat<T>, Val>;
 
-  BitMatch() {}
-  BitMatch(std::initializer_list<InitPair> init) {
-    InitRules(init.begin(), init.end());
+  constexpr BitMatch(const std::array<InitPair, N> &rules)
+      : vals_(), root_(), entries_(), node_count_(0), entry_count_(0),
+        valid_(true) {
+    std::array<Item, N> items = {};
+    for (std::size_t i = 0; i < N; ++i) {
+      vals_[i] = rules[i].second;
+      items[i] = {rules[i].first, static_cast<Index>(i)};
+    }
+    root_ = InitRules(items.data(), N, kNone);
+  }
+
+  // perform bit pattern match
+  constexpr std::optional<Val> Find(T value) const {
+    auto index = FindIndex(value);
+    if (index == kNone) return {};
+    return vals_[index];
+  }
+
+  // perform bit pattern match, returns 'default_val' if not found
+  constexpr Val Find(T value, const Val &default_val) const {
+    auto index = FindIndex(value);
+    return index == kNone ? default_val : vals_[index];
   }
-  BitMatch(std::initializer_list<std::pair<std::string_view, Val>> init) {
-    std::vector<InitPair> init_bp;
-    for (const auto &i : init) init_bp.push_back({{i.first}, i.second});
-    InitRules(init_bp);
+
+  // getters
+  // check if rules are valid (no conflicts)
+  constexpr bool valid() const { return valid_; }
+  // get count of matching rules
+  constexpr std::size_t size() const { return N; }
+  // get count of used nodes
+  constexpr std::size_t node_count() const { return node_count_; }
+  // get count of used entries
+  constexpr std::size_t entry_count() const { return entry_count_; }
+
+ private:
+  using Index = std::uint16_t;
+
+  // index of nothing
+  static constexpr Index kNone = 0xffff;
+  // direct indexed nodes are at most 'kMaxDirectRatio' times
+  // larger than sparse ones
+  static constexpr std::size_t kMaxDirectRatio = 16;
+
+  // kind of entry
+  enum class EntryKind : std::uint8_t { Empty, Value, Check, SubNode };
+
+  // rule in building process
+  struct Item {
+    BitPat<T> pat;
+    Index val;
+  };
+
+  // node of decision tree
+  struct Node {
+    // mask of bits selected by current node
+    T mask;
+    // range of entries (sorted by key)
+    Index begin, count;
+    // index of default value
+    Index default_val;
+    // entries are indexed by 'masked value >> shift' if direct,
+    // otherwise they are searched by key
+    bool is_direct;
+    std::uint8_t shift;
+  };
+
+  // entry of node
+  // sub-node is stored inline, so each level of lookup takes only
+  // one dependent load
+  struct Entry {
+    // masked value
+    T key;
+    EntryKind kind;
+    // index of value
+    Index val;
+    // key checked by 'Check' entry (value if matched,
+    // otherwise default value of sub-node)
+    T check_key;
+    // sub-node
+    Node sub;
+  };
+
+  // find index of value, returns 'kNone' if not found
+  // root node is checked out of the loop, so that its fields can be
+  // folded into constants by compiler
+  constexpr Index FindIndex(T value) const {
+    const Node *node = &root_;
+    auto entry = FindEntry(root_, value);
+    while (entry && entry->kind == EntryKind::SubNode) {
+      node = &entry->sub;
+      entry = FindEntry(*node, value);
+    }
+    // get value
+    if (!entry) return node->default_val;
+    if (entry->kind == EntryKind::Check) {
+      return (value & entry->sub.mask) == entry->check_key
+                 ? entry->val
+                 : entry->sub.default_val;
+    }
+    return entry->val;
   }
 
-  // initialize rules by specific iterator
-  template <typename It>
-  bool InitRules(It begin, It end) {
-    It skip = end;
-    // get current mask
-    mask_ = -1;
-    for (It it = begin; it != end; ++it) {
-      if (!it->first.mask()) {
-        // add to default rule
-        if (!default_val_) {
-          default_val_ = {it->second};
-          // mark as skipped rule
-          skip = it;
+  // find entry of value in specific node, returns 'nullptr' if not found
+  constexpr const Entry *FindEntry(const Node &node, T value) const {
+    auto key = value & node.mask;
+    const Entry *entry = nullptr;
+    if (node.is_direct) {
+      // index directly, key always matches
+      entry = &entries_[node.begin + (key >> node.shift)];
+    }
+    else {
+      // binary search
+      auto l = node.begin;
+      auto r = static_cast<Index>(node.begin + node.count);
+      while (l < r) {
+        auto mid = static_cast<Index>((l + r) / 2);
+        if (entries_[mid].key < key) {
+          l = mid + 1;
         }
         else {
-          return false;
+          r = mid;
         }
       }
-      else {
-        // update current mask
-        mask_ &= it->first.mask();
+      if (l < node.begin + node.count && entries_[l].key == key) {
+        entry = &entries_[l];
       }
     }
-    if (!mask_) return false;
-    // get classified rules
-    std::unordered_map<T, std::vector<InitPair>> rules;
-    for (It it = begin; it != end; ++it) {
-      // skip default rule
-      if (it == skip) continue;
-      // handle the rest
-      const auto &p = it->first;
-      auto &r = rules[p.value() & mask_];
-      r.push_back({{p.value() & ~mask_, p.mask() & ~mask_}, it->second});
-    }
-    // divide and conquer
-    for (const auto &it : rules) {
-      const auto &pairs = it.second;
-      if (pairs.size() == 1 && !pairs.back().first.mask()) {
-        // just add as value
-        matches_.insert({it.first, pairs.back().second});
+    return entry && entry->kind != EntryKind::Empty ? entry : nullptr;
+  }
+
+  // build node by specific rules
+  // 'parent_default' is the default value inherited from parent nodes
+  constexpr Node InitRules(const Item *items, std::size_t count,
+                           Index parent_default) {
+    if (!valid_) return Fail();
+    ++node_count_;
+    // get current mask & default value
+    T mask = static_cast<T>(-1);
+    Index default_val = kNone;
+    for (std::size_t i = 0; i < count; ++i) {
+      if (!items[i].pat.mask()) {
+        // more than one default rule
+        if (default_val != kNone) return Fail();
+        default_val = items[i].val;
       }
       else {
-        // add sub-match
-        auto sub = std::make_unique<BitMatch<T, Val>>();
-        if (!sub->InitRules(pairs)) return false;
-        matches_.insert({it.first, std::move(sub)});
+        mask &= items[i].pat.mask();
       }
     }
-    return true;
-  }
-
-  // initialize rules by initializer vector
-  bool InitRules(const std::vector<InitPair> &init) {
-    return InitRules(init.begin(), init.end());
-  }
-
-  // perform bit pattern match
-  std::optional<Val> Find(T value) {
-    auto it = matches_.find(value & mask_);
-    if (it == matches_.end()) {
-      return default_val_;
-    }
-    else if (auto val_ptr = std::get_if<Val>(&it->second)) {
-      return {*val_ptr};
+    if (!mask) return Fail();
+    // default value of deeper node takes precedence
+    if (default_val == kNone) default_val = parent_default;
+    // get sorted keys of classified rules
+    std::array<T, N> keys = {};
+    std::size_t key_count = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+      if (!items[i].pat.mask()) continue;
+      auto key = items[i].pat.value() & mask;
+      auto pos = key_count;
+      while (pos > 0 && keys[pos - 1] > key) --pos;
+      if (pos > 0 && keys[pos - 1] == key) continue;
+      for (auto j = key_count; j > pos; --j) keys[j] = keys[j - 1];
+      keys[pos] = key;
+      ++key_count;
     }
-    else {
-      auto sub_ptr = std::get_if<SubMatch>(&it->second);
-      assert(sub_ptr);
-      auto ret = (*sub_ptr)->Find(value);
-      return ret ? ret : default_val_;
+    // use direct indexing if the mask is narrow and keys are dense
+    std::size_t shift = 0, span = 0;
+    while (!((mask >> shift) & 1)) ++shift;
+    while (span + shift < sizeof(T) * 8 && (mask >> (span + shift))) {
+      ++span;
     }
-  }
-
-  // get count of matching rules
-  std::size_t GetSize() const {
-    std::size_t size = default_val_ ? 1 : 0;
-    for (const auto &it : matches_) {
-      if (auto sub_ptr = std::get_if<SubMatch>(&it.second)) {
-        size += (*sub_ptr)->GetSize();
+    bool is_direct = span < 16 &&
+                     (std::size_t(1) << span) <= key_count * kMaxDirectRatio;
+    auto entry_num = is_direct ? std::size_t(1) << span : key_count;
+    // reserve entries for current node
+    if (entry_count_ + entry_num > kMaxEntries) return Fail();
+    auto begin = static_cast<Index>(entry_count_);
+    entry_count_ += entry_num;
+    // divide and conquer
+    for (std::size_t k = 0; k < key_count; ++k) {
+      std::array<Item, N> sub = {};
+      std::size_t sub_count = 0;
+      for (std::size_t i = 0; i < count; ++i) {
+        const auto &p = items[i].pat;
+        if (!p.mask() || (p.value() & mask) != keys[k]) continue;
+        sub[sub_count++] = {{static_cast<T>(p.value() & ~mask),
+                             static_cast<T>(p.mask() & ~mask)},
+                            items[i].val};
+      }
+      auto &entry = entries_[begin + (is_direct ? keys[k] >> shift : k)];
+      entry.key = keys[k];
+      // get single rule & default value of sub-node
+      std::size_t rule_count = 0;
+      Index sub_rule = 0, sub_default = kNone;
+      for (std::size_t i = 0; i < sub_count; ++i) {
+        if (sub[i].pat.mask()) {
+          ++rule_count;
+          sub_rule = static_cast<Index>(i);
+        }
+        else if (sub_default == kNone) {
+          sub_default = sub[i].val;
+        }
+        else {
+          return Fail();
+        }
+      }
+      if (sub_count == 1 && !rule_count) {
+        // just add as value
+        entry.val = sub[0].val;
+        entry.kind = EntryKind::Value;
+      }
+      else if (rule_count == 1) {
+        // check the only rule without adding a sub-node
+        const auto &p = sub[sub_rule].pat;
+        entry.val = sub[sub_rule].val;
+        entry.check_key = p.value() & p.mask();
+        entry.sub.mask = p.mask();
+        entry.sub.default_val =
+            sub_default != kNone ? sub_default : default_val;
+        entry.kind = EntryKind::Check;
       }
       else {
-        ++size;
+        // add sub-node
+        entry.sub = InitRules(sub.data(), sub_count, default_val);
+        entry.kind = EntryKind::SubNode;
       }
     }
-    return size;
+    return {mask, begin, static_cast<Index>(entry_num), default_val,
+            is_direct, static_cast<std::uint8_t>(shift)};
   }
 
- private:
-  using SubMatch = std::unique_ptr<BitMatch<T, Val>>;
+  // mark as invalid
+  constexpr Node Fail() {
+    valid_ = false;
+    return {};
+  }
 
-  std::unordered_map<T, std::variant<Val, SubMatch>> matches_;
-  std::optional<Val> default_val_;
-  T mask_;
+  std::array<Val, N> vals_;
+  Node root_;
+  std::array<Entry, kMaxEntries> entries_;
+  std::size_t node_count_, entry_count_;
+  bool valid_;
 };
 
 // bitwise pattern maching for 32-bit data
-template <typename Val>
-using BitMatch32 = BitMatch<std::uint32_t, Val>;
+template <typename Val, std::size_t N, std::size_t kMaxEntries = N * 8>
+using BitMatch32 = BitMatch<std::uint32_t, Val, N, kMaxEntries>;
 
 #endif  // RISKY32_UTIL_BITPAT_H_
@@ -0,0 +1,354 @@
+#include "util/branchpred.h"
+
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+#include <array>
+#include <string>
+#include <utility>
+#include <cassert>
+
+#include "util/cast.h"
+
+namespace {
+
+// size of return-address stack
+constexpr std::size_t kRASSize = 16;
+// entry count of BTB
+constexpr std::size_t kBTBSize = 512;
+// index width of bimodal & gshare pattern history tables
+constexpr std::uint32_t kPHTBits = 12;
+// length of global history of gshare
+constexpr std::uint32_t kGShareHistLen = 12;
+// index & tag width of TAGE tagged tables
+constexpr std::uint32_t kTageIndexBits = 10;
+constexpr std::uint32_t kTageTagBits = 8;
+// global history lengths of TAGE tagged tables (geometric)
+constexpr std::array<std::uint32_t, 4> kTageHistLens = {5, 11, 22, 44};
+
+// check if register is a link register ('ra' or 't0')
+inline bool IsLinkReg(std::uint32_t reg) { return reg == 1 || reg == 5; }
+
+// update 2-bit saturating counter
+inline void UpdateCounter(std::uint8_t &ctr, bool taken) {
+  if (taken && ctr < 3) ++ctr;
+  if (!taken && ctr > 0) --ctr;
+}
+
+// fold the lowest 'len' bits of history into 'bits' bits
+inline std::uint32_t FoldHistory(std::uint64_t hist, std::uint32_t len,
+                                 std::uint32_t bits) {
+  if (len < 64) hist &= (std::uint64_t(1) << len) - 1;
+  std::uint32_t folded = 0;
+  for (; hist; hist >>= bits) folded ^= hist & ((1u << bits) - 1);
+  return folded;
+}
+
+// static predictor, backward taken & forward not taken
+class StaticPredictor : public DirectionPredictor {
+ public:
+  bool Predict(std::uint32_t pc, std::uint32_t target) override {
+    return target <= pc;
+  }
+  void Update(std::uint32_t pc, bool taken) override {}
+};
+
+// bimodal predictor, 2-bit counters indexed by PC
+class BimodalPredictor : public DirectionPredictor {
+ public:
+  BimodalPredictor() : counters_(1 << kPHTBits, 1) {}
+
+  bool Predict(std::uint32_t pc, std::uint32_t target) override {
+    return counters_[GetIndex(pc)] >= 2;
+  }
+  void Update(std::uint32_t pc, bool taken) override {
+    UpdateCounter(counters_[GetIndex(pc)], taken);
+  }
+
+ private:
+  std::uint32_t GetIndex(std::uint32_t pc) const {
+    return (pc >> 2) & ((1 << kPHTBits) - 1);
+  }
+
+  std::vector<std::uint8_t> counters_;
+};
+
+// gshare predictor, 2-bit counters indexed by PC xor global history
+class GSharePredictor : public DirectionPredictor {
+ public:
+  GSharePredictor() : counters_(1 << kPHTBits, 1), hist_(0) {}
+
+  bool Predict(std::uint32_t pc, std::uint32_t target) override {
+    return counters_[GetIndex(pc)] >= 2;
+  }
+  void Update(std::uint32_t pc, bool taken) override {
+    UpdateCounter(counters_[GetIndex(pc)], taken);
+    hist_ = ((hist_ << 1) | taken) & ((1 << kGShareHistLen) - 1);
+  }
+
+ private:
+  std::uint32_t GetIndex(std::uint32_t pc) const {
+    return ((pc >> 2) ^ hist_) & ((1 << kPHTBits) - 1);
+  }
+
+  std::vector<std::uint8_t> counters_;
+  std::uint32_t hist_;
+};
+
+// simplified TAGE predictor
+// a bimodal base predictor and several tagged tables indexed by
+// geometric lengths of global history, the longest matching table
+// provides the prediction
+class TagePredictor : public DirectionPredictor {
+ public:
+  TagePredictor()
+      : base_(1 << kPHTBits, 1), hist_(0), seed_(0x2545f491) {
+    for (auto &table : tables_) {
+      table.resize(1 << kTageIndexBits, {kInvalidTag, 0, 0});
+    }
+  }
+
+  bool Predict(std::uint32_t pc, std::uint32_t target) override {
+    // compute indices & tags, and find provider & alternate tables
+    provider_ = alt_ = kTableCount;
+    for (std::size_t i = kTableCount; i-- > 0;) {
+      auto len = kTageHistLens[i];
+      indices_[i] = ((pc >> 2) ^ FoldHistory(hist_, len, kTageIndexBits)) &
+                    ((1 << kTageIndexBits) - 1);
+      tags_[i] = ((pc >> 2) ^ FoldHistory(hist_, len, kTageTagBits) ^
+                  (FoldHistory(hist_, len, kTageTagBits - 1) << 1)) &
+                 ((1 << kTageTagBits) - 1);
+      if (tables_[i][indices_[i]].tag != tags_[i]) continue;
+      if (provider_ == kTableCount) {
+        provider_ = i;
+      }
+      else if (alt_ == kTableCount) {
+        alt_ = i;
+      }
+    }
+    // get predictions
+    base_pred_ = base_[GetBaseIndex(pc)] >= 2;
+    alt_pred_ = alt_ == kTableCount ? base_pred_ : GetPred(alt_);
+    pred_ = provider_ == kTableCount ? base_pred_ : GetPred(provider_);
+    return pred_;
+  }
+
+  void Update(std::uint32_t pc, bool taken) override {
+    if (provider_ == kTableCount) {
+      UpdateCounter(base_[GetBaseIndex(pc)], taken);
+    }
+    else {
+      auto &entry = tables_[provider_][indices_[provider_]];
+      // update useful counter if provider differs from alternate
+      if (pred_ != alt_pred_) {
+        if (pred_ == taken && entry.useful < 3) ++entry.useful;
+        if (pred_ != taken && entry.useful > 0) --entry.useful;
+      }
+      if (taken && entry.ctr < 3) ++entry.ctr;
+      if (!taken && entry.ctr > -4) --entry.ctr;
+    }
+    // allocate an entry in a longer table if mispredicted
+    if (pred_ != taken) Allocate(taken);
+    hist_ = (hist_ << 1) | taken;
+  }
+
+ private:
+  // entry of tagged table
+  struct Entry {
+    // partial tag
+    std::uint16_t tag;
+    // 3-bit signed prediction counter
+    std::int8_t ctr;
+    // 2-bit useful counter
+    std::uint8_t useful;
+  };
+
+  static constexpr std::size_t kTableCount = kTageHistLens.size();
+  // tag of invalid entry, never matches partial tags
+  static constexpr std::uint16_t kInvalidTag = 0xffff;
+
+  std::uint32_t GetBaseIndex(std::uint32_t pc) const {
+    return (pc >> 2) & ((1 << kPHTBits) - 1);
+  }
+  bool GetPred(std::size_t table) const {
+    return tables_[table][indices_[table]].ctr >= 0;
+  }
+
+  // allocate an entry in tables longer than provider
+  void Allocate(bool taken) {
+    auto first = provider_ == kTableCount ? 0 : provider_ + 1;
+    if (first >= kTableCount) return;
+    // start from a random table, so that entries are not always
+    // allocated in the shortest one
+    seed_ ^= seed_ << 13;
+    seed_ ^= seed_ >> 17;
+    seed_ ^= seed_ << 5;
+    if (first + 1 < kTableCount && (seed_ & 1)) ++first;
+    for (auto i = first; i < kTableCount; ++i) {
+      auto &entry = tables_[i][indices_[i]];
+      if (!entry.useful) {
+        entry = {static_cast<std::uint16_t>(tags_[i]),
+                 static_cast<std::int8_t>(taken ? 0 : -1), 0};
+        return;
+      }
+    }
+    // no entry available, age all candidates
+    for (auto i = first; i < kTableCount; ++i) {
+      --tables_[i][indices_[i]].useful;
+    }
+  }
+
+  // base predictor
+  std::vector<std::uint8_t> base_;
+  // tagged tables
+  std::array<std::vector<Entry>, kTableCount> tables_;
+  // global history
+  std::uint64_t hist_;
+  // random seed of allocation
+  std::uint32_t seed_;
+  // states of the last prediction
+  std::array<std::uint32_t, kTableCount> indices_, tags_;
+  std::size_t provider_, alt_;
+  bool base_pred_, alt_pred_, pred_;
+};
+
+// get target address of conditional branch
+inline std::uint32_t GetBranchTarget(std::uint32_t pc,
+                                     std::uint32_t inst_data) {
+  auto inst = PtrCast<InstS>(&inst_data);
+  auto ofs0 = (inst->imm5 >> 0) & 0x1;
+  auto ofs1 = (inst->imm5 >> 1) & 0xf;
+  auto ofs2 = (inst->imm7 >> 0) & 0x3f;
+  auto ofs3 = (inst->imm7 >> 6) & 0x1;
+  auto offset = (ofs3 << 12) | (ofs2 << 5) | (ofs1 << 1) | (ofs0 << 11);
+  offset = offset & (1 << 12) ? 0xffffe000 | offset : offset;
+  return pc + offset;
+}
+
+}  // namespace
+
+DirectionPredictorPtr MakeDirectionPredictor(std::string_view name) {
+  if (name == "static") return std::make_unique<StaticPredictor>();
+  if (name == "bimodal") return std::make_unique<BimodalPredictor>();
+  if (name == "gshare") return std::make_unique<GSharePredictor>();
+  if (name == "tage") return std::make_unique<TagePredictor>();
+  return nullptr;
+}
+
+BranchModel::BranchModel(DirectionPredictorPtr predictor)
+    : predictor_(std::move(predictor)), ras_(kRASSize), ras_top_(0),
+      ras_count_(0), btb_(kBTBSize, {0, 0}) {
+  assert(predictor_);
+}
+
+void BranchModel::HandleJump(std::uint32_t pc, std::uint32_t inst_data,
+                             std::uint32_t next_pc) {
+  auto inst = PtrCast<InstI>(&inst_data);
+  BranchKind kind;
+  bool correct = true;
+  if (inst->opcode == kBranch) {
+    // conditional branch
+    kind = kKindCond;
+    auto taken = next_pc != pc + 4;
+    correct = predictor_->Predict(pc, GetBranchTarget(pc, inst_data)) ==
+              taken;
+    predictor_->Update(pc, taken);
+  }
+  else if (inst->opcode == kJAL) {
+    // direct jump, target is known at decode stage
+    kind = kKindJump;
+    if (IsLinkReg(inst->rd)) PushReturn(pc + 4);
+  }
+  else {
+    // indirect jump, classified by hints of link registers
+    auto rd_link = IsLinkReg(inst->rd), rs1_link = IsLinkReg(inst->rs1);
+    if (rs1_link && (!rd_link || inst->rd != inst->rs1)) {
+      // return (or coroutine switch)
+      kind = kKindReturn;
+      correct = PredictReturn(next_pc);
+    }
+    else {
+      kind = kKindIndirect;
+      correct = PredictIndirect(pc, next_pc);
+    }
+    if (rd_link) PushReturn(pc + 4);
+  }
+  // update statistics
+  auto &stats = branches_.try_emplace(pc, BranchStats{kind, 0, 0})
+                    .first->second;
+  ++stats.count;
+  if (!correct) ++stats.mispredicts;
+}
+
+bool BranchModel::PredictIndirect(std::uint32_t pc,
+                                  std::uint32_t next_pc) {
+  auto &entry = btb_[(pc >> 2) & (kBTBSize - 1)];
+  auto correct = entry.pc == pc && entry.target == next_pc;
+  entry = {pc, next_pc};
+  return correct;
+}
+
+bool BranchModel::PredictReturn(std::uint32_t next_pc) {
+  if (!ras_count_) return false;
+  ras_top_ = (ras_top_ + kRASSize - 1) % kRASSize;
+  --ras_count_;
+  return ras_[ras_top_] == next_pc;
+}
+
+void BranchModel::PushReturn(std::uint32_t ret_addr) {
+  ras_[ras_top_] = ret_addr;
+  ras_top_ = (ras_top_ + 1) % kRASSize;
+  if (ras_count_ < kRASSize) ++ras_count_;
+}
+
+bool BranchModel::WriteReport(std::string_view file,
+                              const SymbolTable &symbols) const {
+  static const char *kKindNames[kKindCount] = {
+      "branch", "jump", "indirect", "return",
+  };
+  std::ofstream ofs{std::string(file)};
+  if (!ofs) return false;
+  // get totals of all kinds
+  std::array<std::uint64_t, kKindCount> counts = {}, mispredicts = {};
+  std::vector<std::pair<std::uint32_t, const BranchStats *>> pcs;
+  for (const auto &[pc, stats] : branches_) {
+    counts[stats.kind] += stats.count;
+    mispredicts[stats.kind] += stats.mispredicts;
+    if (stats.mispredicts) pcs.push_back({pc, &stats});
+  }
+  // print statistics of all kinds
+  ofs << "Branch prediction statistics:" << std::endl;
+  ofs << std::endl;
+  ofs << "kind              count   mispredicts     rate" << std::endl;
+  for (int i = 0; i < kKindCount; ++i) {
+    ofs << std::left << std::setw(8) << kKindNames[i] << std::right
+        << std::setw(14) << counts[i] << std::setw(14) << mispredicts[i]
+        << std::setw(8) << std::fixed << std::setprecision(2)
+        << (counts[i] ? mispredicts[i] * 100.0 / counts[i] : 0.0) << "%"
+        << std::endl;
+  }
+  // sort PCs by mispredictions, and then by address
+  std::sort(pcs.begin(), pcs.end(), [](const auto &lhs, const auto &rhs) {
+    return lhs.second->mispredicts != rhs.second->mispredicts
+               ? lhs.second->mispredicts > rhs.second->mispredicts
+               : lhs.first < rhs.first;
+  });
+  // print mispredictions of each PC
+  ofs << std::endl;
+  ofs << "Mispredicted branches:" << std::endl;
+  ofs << std::endl;
+  ofs << "   mispredicts         count     rate  kind       address  symbol"
+      << std::endl;
+  for (const auto &[pc, stats] : pcs) {
+    ofs << std::setw(14) << std::setfill(' ') << std::dec
+        << stats->mispredicts << std::setw(14) << stats->count
+        << std::setw(8) << stats->mispredicts * 100.0 / stats->count
+        << "%  " << std::left << std::setw(8) << kKindNames[stats->kind]
+        << std::right << "  " << std::setw(8) << std::setfill('0')
+        << std::hex << pc;
+    auto name = symbols.Symbolize(pc);
+    if (!name.empty()) ofs << "  " << name;
+    ofs << std::endl;
+  }
+  return static_cast<bool>(ofs);
+}
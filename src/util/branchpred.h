@@ -0,0 +1,92 @@
+#ifndef RISKY32_UTIL_BRANCHPRED_H_
+#define RISKY32_UTIL_BRANCHPRED_H_
+
+#include <memory>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+
+#include "define/inst.h"
+#include "util/symtab.h"
+
+// interface of direction predictors of conditional branches
+class DirectionPredictor {
+ public:
+  virtual ~DirectionPredictor() = default;
+
+  // predict if branch at 'pc' (jumps to 'target' if taken) is taken
+  virtual bool Predict(std::uint32_t pc, std::uint32_t target) = 0;
+  // update predictor by the actual direction of the last predicted
+  // branch, always called right after 'Predict'
+  virtual void Update(std::uint32_t pc, bool taken) = 0;
+};
+
+using DirectionPredictorPtr = std::unique_ptr<DirectionPredictor>;
+
+// create direction predictor by name ('static', 'bimodal', 'gshare'
+// or 'tage'), returns 'nullptr' if name is invalid
+DirectionPredictorPtr MakeDirectionPredictor(std::string_view name);
+
+// branch prediction model of retired instructions
+// conditional branches are predicted by the direction predictor,
+// returns ('jalr' through link register) are predicted by a
+// return-address stack, other 'jalr' are predicted by a BTB, and
+// 'jal' is always predicted correctly
+class BranchModel {
+ public:
+  BranchModel(DirectionPredictorPtr predictor);
+
+  // handle a retired instruction
+  void Retire(std::uint32_t pc, std::uint32_t inst_data,
+              std::uint32_t next_pc) {
+    auto opcode = inst_data & 0x7f;
+    if (opcode == kBranch || opcode == kJAL || opcode == kJALR) {
+      HandleJump(pc, inst_data, next_pc);
+    }
+  }
+
+  // write statistics & mispredictions of each branch PC,
+  // returns false if failed
+  bool WriteReport(std::string_view file, const SymbolTable &symbols) const;
+
+ private:
+  // kind of branch
+  enum BranchKind {
+    kKindCond, kKindJump, kKindIndirect, kKindReturn, kKindCount,
+  };
+
+  // statistics of a branch
+  struct BranchStats {
+    BranchKind kind;
+    std::uint64_t count, mispredicts;
+  };
+
+  // entry of BTB
+  struct BTBEntry {
+    std::uint32_t pc, target;
+  };
+
+  // handle a retired branch or jump
+  void HandleJump(std::uint32_t pc, std::uint32_t inst_data,
+                  std::uint32_t next_pc);
+  // predict target of indirect jump and update BTB
+  bool PredictIndirect(std::uint32_t pc, std::uint32_t next_pc);
+  // predict target of return and pop return-address stack
+  bool PredictReturn(std::uint32_t next_pc);
+  // push return address to return-address stack
+  void PushReturn(std::uint32_t ret_addr);
+
+  // direction predictor
+  DirectionPredictorPtr predictor_;
+  // return-address stack (circular, overflowed entries are lost)
+  std::vector<std::uint32_t> ras_;
+  std::size_t ras_top_, ras_count_;
+  // branch target buffer (direct mapped)
+  std::vector<BTBEntry> btb_;
+  // statistics of each branch PC
+  std::unordered_map<std::uint32_t, BranchStats> branches_;
+};
+
+#endif  // RISKY32_UTIL_BRANCHPRED_H_
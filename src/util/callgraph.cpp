@@ -0,0 +1,141 @@
+#include "util/callgraph.h"
+
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <cassert>
+
+#include "util/cast.h"
+
+namespace {
+
+// max depth of shadow stack
+constexpr std::size_t kMaxStackDepth = 4096;
+
+// check if register is a link register ('ra' or 't0')
+inline bool IsLinkReg(std::uint32_t reg) { return reg == 1 || reg == 5; }
+
+}  // namespace
+
+CallGraphProfiler::CallGraphProfiler(std::uint32_t sample_period)
+    : sample_period_(sample_period), countdown_(sample_period),
+      dropped_(0) {
+  assert(sample_period);
+  nodes_.push_back({0, 0, false, 0});
+}
+
+void CallGraphProfiler::Reset(std::uint32_t pc) {
+  stack_.clear();
+  dropped_ = 0;
+  Push(pc, 0, false);
+}
+
+void CallGraphProfiler::Trap(std::uint32_t handler) {
+  Push(handler, 0, true);
+}
+
+void CallGraphProfiler::HandleJump(std::uint32_t pc,
+                                   std::uint32_t inst_data,
+                                   std::uint32_t next_pc) {
+  auto inst = PtrCast<InstI>(&inst_data);
+  if (inst->opcode == kSystem) {
+    if (inst->funct3 != kPRIV || inst->rd || inst->rs1) return;
+    if (inst->imm != kMRET && inst->imm != kSRET) return;
+    // return from trap, pop frames up to the last trap frame
+    dropped_ = 0;
+    while (stack_.size() > 1) {
+      auto is_trap = stack_.back().is_trap;
+      stack_.pop_back();
+      if (is_trap) break;
+    }
+  }
+  else if (IsLinkReg(inst->rd)) {
+    // 'JAL'/'JALR' with link register, function call
+    Push(next_pc, pc + 4, false);
+  }
+  else if (inst->opcode == kJALR && !inst->rd && IsLinkReg(inst->rs1)) {
+    // function return
+    if (dropped_) {
+      --dropped_;
+      return;
+    }
+    // find frame by return address, and pop it with all frames above
+    // frames of current trap handler are checked only
+    for (auto i = stack_.size(); i > 1; --i) {
+      const auto &frame = stack_[i - 1];
+      if (frame.ret_addr == next_pc) {
+        stack_.resize(i - 1);
+        return;
+      }
+      if (frame.is_trap) break;
+    }
+    // not found, just pop the top frame
+    if (stack_.size() > 1 && !stack_.back().is_trap) stack_.pop_back();
+  }
+}
+
+void CallGraphProfiler::Push(std::uint32_t entry, std::uint32_t ret_addr,
+                             bool is_trap) {
+  if (stack_.size() >= kMaxStackDepth) {
+    ++dropped_;
+    return;
+  }
+  stack_.push_back({entry, ret_addr, 0, is_trap});
+}
+
+void CallGraphProfiler::Sample() {
+  countdown_ = sample_period_;
+  if (stack_.empty()) return;
+  // resolve nodes of new frames
+  std::size_t i = stack_.size();
+  while (i > 0 && !stack_[i - 1].node) --i;
+  for (; i < stack_.size(); ++i) {
+    auto parent = i ? stack_[i - 1].node : 0;
+    stack_[i].node = GetChild(parent, stack_[i]);
+  }
+  ++nodes_[stack_.back().node].samples;
+}
+
+std::uint32_t CallGraphProfiler::GetChild(std::uint32_t parent,
+                                          const Frame &frame) {
+  // entry addresses are 4-byte aligned, use bit 0 as trap flag
+  auto key = (static_cast<std::uint64_t>(parent) << 32) | frame.entry |
+             frame.is_trap;
+  auto it = children_.find(key);
+  if (it != children_.end()) return it->second;
+  auto id = static_cast<std::uint32_t>(nodes_.size());
+  nodes_.push_back({frame.entry, parent, frame.is_trap, 0});
+  children_.insert({key, id});
+  return id;
+}
+
+bool CallGraphProfiler::WriteFolded(std::string_view file,
+                                    const SymbolTable &symbols) const {
+  std::ofstream ofs{std::string(file)};
+  if (!ofs) return false;
+  // get names of all nodes
+  std::vector<std::string> names(nodes_.size());
+  for (std::size_t i = 1; i < nodes_.size(); ++i) {
+    const auto &node = nodes_[i];
+    std::string name;
+    if (node.is_trap) name = "[trap] ";
+    if (auto sym = symbols.Find(node.entry)) {
+      name += symbols.GetName(*sym);
+    }
+    else {
+      std::ostringstream oss;
+      oss << "0x" << std::hex << std::setw(8) << std::setfill('0')
+          << node.entry;
+      name += oss.str();
+    }
+    // parents are always created before children
+    names[i] = node.parent ? names[node.parent] + ';' + name : name;
+  }
+  // print all sampled stacks
+  for (std::size_t i = 1; i < nodes_.size(); ++i) {
+    if (!nodes_[i].samples) continue;
+    ofs << names[i] << ' ' << nodes_[i].samples << std::endl;
+  }
+  return static_cast<bool>(ofs);
+}
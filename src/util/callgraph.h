@@ -0,0 +1,88 @@
+#ifndef RISKY32_UTIL_CALLGRAPH_H_
+#define RISKY32_UTIL_CALLGRAPH_H_
+
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+
+#include "define/inst.h"
+#include "util/symtab.h"
+
+// call-graph profiler
+// a shadow call stack is maintained by retired jumps: 'jal/jalr' with
+// link register 'ra' (or 't0') pushes a frame, 'jalr' through link
+// register pops frames, traps push a trap frame and 'mret/sret' pops
+// frames up to the last trap frame
+// the stack is sampled periodically into a call tree, so that only
+// frames pushed since the last sample need to be looked up
+class CallGraphProfiler {
+ public:
+  CallGraphProfiler(std::uint32_t sample_period);
+
+  // reset the shadow stack, with the current PC as the root frame
+  void Reset(std::uint32_t pc);
+  // handle a retired instruction
+  void Retire(std::uint32_t pc, std::uint32_t inst_data,
+              std::uint32_t next_pc) {
+    if (!--countdown_) Sample();
+    auto opcode = inst_data & 0x7f;
+    if (opcode == kJAL || opcode == kJALR || opcode == kSystem) {
+      HandleJump(pc, inst_data, next_pc);
+    }
+  }
+  // handle a trap, 'handler' is the address of trap handler
+  void Trap(std::uint32_t handler);
+
+  // write samples in folded-stack format, returns false if failed
+  bool WriteFolded(std::string_view file, const SymbolTable &symbols) const;
+
+ private:
+  // frame of shadow stack
+  struct Frame {
+    // entry address of function (or trap handler)
+    std::uint32_t entry;
+    // return address
+    std::uint32_t ret_addr;
+    // id of node in call tree (0 if not resolved)
+    std::uint32_t node;
+    // true if frame is pushed by trap
+    bool is_trap;
+  };
+
+  // node of call tree
+  struct Node {
+    // entry address of function
+    std::uint32_t entry;
+    // id of parent node
+    std::uint32_t parent;
+    // true if node is a trap handler
+    bool is_trap;
+    // count of samples whose top frame is this node
+    std::uint64_t samples;
+  };
+
+  // handle a retired jump or system instruction
+  void HandleJump(std::uint32_t pc, std::uint32_t inst_data,
+                  std::uint32_t next_pc);
+  // push a frame
+  void Push(std::uint32_t entry, std::uint32_t ret_addr, bool is_trap);
+  // take a sample of the current stack
+  void Sample();
+  // get id of child node, create one if not found
+  std::uint32_t GetChild(std::uint32_t parent, const Frame &frame);
+
+  // sample period (in retired instructions)
+  std::uint32_t sample_period_, countdown_;
+  // shadow stack
+  std::vector<Frame> stack_;
+  // count of frames dropped since the stack is too deep
+  std::size_t dropped_;
+  // call tree (node 0 is a dummy root)
+  std::vector<Node> nodes_;
+  // hashmap of (parent id, entry, is_trap) to child id
+  std::unordered_map<std::uint64_t, std::uint32_t> children_;
+};
+
+#endif  // RISKY32_UTIL_CALLGRAPH_H_
@@ -0,0 +1,339 @@
+#include "util/commitlog.h"
+
+#include <string>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include "util/tracer.h"
+
+namespace {
+
+// size of decompressed data buffer
+constexpr std::size_t kInflateBufSize = 1 << 20;
+
+// cursor of text in Spike log
+class TextCursor {
+ public:
+  TextCursor(const char *cur, const char *end) : cur_(cur), end_(end) {}
+
+  // skip spaces & tabs
+  void SkipSpaces() {
+    while (cur_ < end_ && (*cur_ == ' ' || *cur_ == '\t')) ++cur_;
+  }
+  // consume the specific string, returns false if not matched
+  bool Eat(std::string_view str) {
+    if (static_cast<std::size_t>(end_ - cur_) < str.size() ||
+        std::memcmp(cur_, str.data(), str.size())) {
+      return false;
+    }
+    cur_ += str.size();
+    return true;
+  }
+  // read a decimal number, returns false if failed
+  bool ReadDec(std::uint32_t &value) {
+    if (cur_ >= end_ || *cur_ < '0' || *cur_ > '9') return false;
+    for (value = 0; cur_ < end_ && *cur_ >= '0' && *cur_ <= '9'; ++cur_) {
+      value = value * 10 + (*cur_ - '0');
+    }
+    return true;
+  }
+  // read a hexadecimal number with prefix '0x', and truncate it
+  // to 32 bits, returns false if failed
+  bool ReadHex(std::uint32_t &value) {
+    if (!Eat("0x")) return false;
+    auto start = cur_;
+    for (value = 0; cur_ < end_; ++cur_) {
+      auto c = *cur_;
+      if (c >= '0' && c <= '9') {
+        value = (value << 4) | (c - '0');
+      }
+      else if ((c | 0x20) >= 'a' && (c | 0x20) <= 'f') {
+        value = (value << 4) | ((c | 0x20) - 'a' + 10);
+      }
+      else {
+        break;
+      }
+    }
+    return cur_ != start;
+  }
+  // skip to the end of the current token
+  void SkipToken() {
+    while (cur_ < end_ && *cur_ != ' ' && *cur_ != '\t') ++cur_;
+  }
+
+  // getters
+  bool at_end() const { return cur_ >= end_; }
+  char peek() const { return *cur_; }
+
+ private:
+  const char *cur_, *end_;
+};
+
+// parse a line of Spike log
+// returns false if the line is not an instruction record,
+// 'is_commit' will be set if the line contains commit information
+bool ParseSpikeLine(const char *line, const char *end, CommitRecord &rec,
+                    bool &is_commit) {
+  // 'core <n>: '
+  TextCursor cur(line, end);
+  std::uint32_t num;
+  cur.SkipSpaces();
+  if (!cur.Eat("core")) return false;
+  cur.SkipSpaces();
+  if (!cur.ReadDec(num) || !cur.Eat(":")) return false;
+  // privilege level (commit log only)
+  cur.SkipSpaces();
+  auto pc_cur = cur;
+  is_commit = !cur.Eat("0x") && cur.ReadDec(num);
+  if (!is_commit) cur = pc_cur;
+  cur.SkipSpaces();
+  // PC & instruction data
+  if (!cur.ReadHex(rec.pc)) return false;
+  cur.SkipSpaces();
+  if (!cur.Eat("(") || !cur.ReadHex(rec.inst) || !cur.Eat(")")) {
+    return false;
+  }
+  // write-back of integer register
+  rec.rd = rec.rd_value = 0;
+  rec.has_wb = is_commit;
+  while (is_commit) {
+    cur.SkipSpaces();
+    if (cur.at_end()) break;
+    if (cur.Eat("x") && cur.ReadDec(num) && num < 32 && !cur.at_end() &&
+        (cur.peek() == ' ' || cur.peek() == '\t')) {
+      cur.SkipSpaces();
+      std::uint32_t value;
+      if (cur.ReadHex(value) && num) {
+        rec.rd = num;
+        rec.rd_value = value;
+        break;
+      }
+    }
+    cur.SkipToken();
+  }
+  return true;
+}
+
+// max size of a LEB128 encoded 32-bit number
+constexpr int kMaxLEB128Size = 5;
+
+// reader of unsigned LEB128 numbers in buffer ['p', 'end'),
+// returns false if number is truncated or too long
+inline bool GetULEB128(const std::uint8_t *&p, const std::uint8_t *end,
+                       std::uint32_t &value) {
+  value = 0;
+  for (int i = 0; i < kMaxLEB128Size && p < end; ++i) {
+    auto byte = *p++;
+    value |= static_cast<std::uint32_t>(byte & 0x7f) << (i * 7);
+    if (!(byte & 0x80)) return true;
+  }
+  return false;
+}
+
+// reader of signed LEB128 numbers in buffer ['p', 'end'),
+// returns false if number is truncated or too long
+inline bool GetSLEB128(const std::uint8_t *&p, const std::uint8_t *end,
+                       std::uint32_t &value) {
+  value = 0;
+  for (int i = 0; i < kMaxLEB128Size && p < end; ++i) {
+    auto byte = *p++;
+    auto shift = i * 7;
+    value |= static_cast<std::uint32_t>(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) {
+      if ((byte & 0x40) && shift + 7 < 32) value |= ~0u << (shift + 7);
+      return true;
+    }
+  }
+  return false;
+}
+
+// decode a record of execution trace in buffer ['p', 'end'),
+// returns false if record is truncated or malformed
+bool DecodeRecord(const std::uint8_t *&p, const std::uint8_t *end,
+                  std::uint32_t &next_pc, CommitRecord &rec) {
+  if (p >= end) return false;
+  auto flags = *p++;
+  std::uint32_t value;
+  if (flags & 0b1) {
+    if (!GetSLEB128(p, end, value)) return false;
+    next_pc += value;
+  }
+  rec.pc = next_pc;
+  next_pc += 4;
+  if (end - p < 4) return false;
+  rec.inst = p[0] | (p[1] << 8) | (p[2] << 16) |
+             (static_cast<std::uint32_t>(p[3]) << 24);
+  p += 4;
+  rec.rd = rec.rd_value = 0;
+  rec.has_wb = true;
+  if (flags & 0b10) {
+    if (p >= end) return false;
+    rec.rd = *p++;
+    if (rec.rd >= 32 || !GetULEB128(p, end, rec.rd_value)) return false;
+  }
+  if ((flags & 0b100) && !GetSLEB128(p, end, value)) return false;
+  if ((flags & 0b1000) && !GetULEB128(p, end, value)) return false;
+  return true;
+}
+
+}  // namespace
+
+CommitLogReader::CommitLogReader()
+    : data_(nullptr), size_(0), done_(true), stop_(false),
+      failed_(false),
+      queue_(std::make_unique<SPSCQueue<CommitRecord, kQueueSize>>()) {}
+
+bool CommitLogReader::Open(std::string_view file) {
+  Close();
+  // map log file into memory
+  auto fd = open(std::string(file).c_str(), O_RDONLY);
+  if (fd < 0) return false;
+  struct stat st;
+  if (fstat(fd, &st) < 0 || !st.st_size) {
+    close(fd);
+    return false;
+  }
+  auto data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) return false;
+  madvise(data, st.st_size, MADV_SEQUENTIAL);
+  data_ = static_cast<const std::uint8_t *>(data);
+  size_ = st.st_size;
+  // start parser thread, gzip compressed files are execution traces
+  done_ = stop_ = failed_ = false;
+  auto is_trace = size_ >= 2 && data_[0] == 0x1f && data_[1] == 0x8b;
+  parser_ = std::thread([this, is_trace] {
+    if (is_trace) {
+      ParseTrace();
+    }
+    else {
+      ParseSpikeLog();
+    }
+    done_.store(true, std::memory_order_release);
+  });
+  return true;
+}
+
+void CommitLogReader::Close() {
+  if (!data_) return;
+  stop_ = true;
+  parser_.join();
+  munmap(const_cast<std::uint8_t *>(data_), size_);
+  data_ = nullptr;
+  size_ = 0;
+  // drop remaining records
+  CommitRecord record;
+  while (queue_->Pop(record)) {}
+}
+
+bool CommitLogReader::Put(const CommitRecord &record) {
+  while (!queue_->Push(record)) {
+    if (stop_) return false;
+    std::this_thread::yield();
+  }
+  return true;
+}
+
+void CommitLogReader::ParseSpikeLog() {
+  auto begin = reinterpret_cast<const char *>(data_);
+  auto end = begin + size_;
+  // get the end of line
+  auto line_end = [end](const char *line) {
+    auto p = static_cast<const char *>(
+        std::memchr(line, '\n', end - line));
+    return p ? p : end;
+  };
+  // Spike prints both instruction traces and commit logs if
+  // enabled together, use commit logs only in this case
+  bool commit_mode = false;
+  CommitRecord rec;
+  bool is_commit;
+  int found = 0;
+  for (auto line = begin; line < end && found < 2;) {
+    auto eol = line_end(line);
+    if (ParseSpikeLine(line, eol, rec, is_commit)) {
+      commit_mode |= is_commit;
+      ++found;
+    }
+    line = eol + 1;
+  }
+  // parse all records
+  for (auto line = begin; line < end;) {
+    auto eol = line_end(line);
+    if (ParseSpikeLine(line, eol, rec, is_commit) &&
+        is_commit == commit_mode && !Put(rec)) {
+      return;
+    }
+    line = eol + 1;
+  }
+}
+
+void CommitLogReader::ParseTrace() {
+  z_stream zs = {};
+  if (inflateInit2(&zs, kTraceGzipWindowBits) != Z_OK) {
+    failed_ = true;
+    return;
+  }
+  zs.next_in = const_cast<std::uint8_t *>(data_);
+  zs.avail_in = size_;
+  auto buf = std::make_unique<std::uint8_t[]>(kInflateBufSize);
+  std::size_t len = 0;
+  bool header = true, stream_end = false;
+  std::uint32_t next_pc = 0;
+  while (!stop_) {
+    // decompress more data
+    if (!stream_end) {
+      zs.next_out = buf.get() + len;
+      zs.avail_out = kInflateBufSize - len;
+      auto ret = inflate(&zs, Z_NO_FLUSH);
+      if (ret == Z_STREAM_END) {
+        stream_end = true;
+      }
+      else if (ret != Z_OK) {
+        failed_ = true;
+        break;
+      }
+      len = kInflateBufSize - zs.avail_out;
+    }
+    const std::uint8_t *p = buf.get(), *end = p + len;
+    // check header
+    if (header) {
+      if (len < kTraceHeaderSize) {
+        if (!stream_end) continue;
+        failed_ = true;
+        break;
+      }
+      auto v = p + sizeof(kTraceMagic);
+      auto version = v[0] | (v[1] << 8) | (v[2] << 16) |
+                     (static_cast<std::uint32_t>(v[3]) << 24);
+      if (std::memcmp(p, kTraceMagic, sizeof(kTraceMagic)) ||
+          version != kTraceVersion) {
+        failed_ = true;
+        break;
+      }
+      p += kTraceHeaderSize;
+      header = false;
+    }
+    // decode records, a record may be cut at the end of buffer
+    while (p < end &&
+           (stream_end ||
+            static_cast<std::size_t>(end - p) >= kTraceMaxRecordSize)) {
+      CommitRecord rec;
+      if (!DecodeRecord(p, end, next_pc, rec)) {
+        failed_ = true;
+        break;
+      }
+      if (!Put(rec)) break;
+    }
+    if (failed_ || (stream_end && p >= end)) break;
+    // move the remaining data to the beginning of buffer
+    len = end - p;
+    std::memmove(buf.get(), p, len);
+  }
+  inflateEnd(&zs);
+}
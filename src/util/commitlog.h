@@ -0,0 +1,77 @@
+#ifndef RISKY32_UTIL_COMMITLOG_H_
+#define RISKY32_UTIL_COMMITLOG_H_
+
+#include <string_view>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+#include "util/spscqueue.h"
+
+// record of a retired instruction in commit log
+struct CommitRecord {
+  std::uint32_t pc;
+  std::uint32_t inst;
+  // destination register (0 if no write-back) & value written
+  std::uint32_t rd;
+  std::uint32_t rd_value;
+  // false if write-back is not recorded in log
+  bool has_wb;
+};
+
+// streaming reader of reference commit logs, supports:
+//   execution trace files of 'TraceWriter' (see 'util/tracer.h')
+//   Spike commit logs ('--log-commits', lines like
+//     'core   0: 3 0x80000000 (0x00000297) x5  0x80000000'),
+//     or instruction traces ('-l', without write-back)
+// log file is mapped into memory and parsed by a separate thread,
+// records are passed to the reader through a lock-free queue
+class CommitLogReader {
+ public:
+  CommitLogReader();
+  ~CommitLogReader() { Close(); }
+
+  // open log file and start parser thread, returns false if failed
+  bool Open(std::string_view file);
+  // stop parser thread and close log file
+  void Close();
+
+  // get the next record, returns false if reached the end of log
+  bool Next(CommitRecord &record) {
+    while (!queue_->Pop(record)) {
+      if (done_.load(std::memory_order_acquire)) {
+        return queue_->Pop(record);
+      }
+      std::this_thread::yield();
+    }
+    return true;
+  }
+
+  // getters
+  // check if log file is malformed
+  bool failed() const { return failed_; }
+
+ private:
+  // size of record queue
+  static constexpr std::size_t kQueueSize = 1 << 16;
+
+  // push a record to queue, returns false if reader is closing
+  bool Put(const CommitRecord &record);
+  // parse Spike log
+  void ParseSpikeLog();
+  // parse execution trace file
+  void ParseTrace();
+
+  // mapped log file
+  const std::uint8_t *data_;
+  std::size_t size_;
+  // parser thread
+  std::thread parser_;
+  std::atomic<bool> done_, stop_, failed_;
+  // queue of parsed records
+  std::unique_ptr<SPSCQueue<CommitRecord, kQueueSize>> queue_;
+};
+
+#endif  // RISKY32_UTIL_COMMITLOG_H_
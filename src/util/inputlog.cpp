@@ -0,0 +1,107 @@
+#include "util/inputlog.h"
+
+#include <string>
+#include <cstring>
+
+namespace {
+
+// magic number of input log file
+constexpr char kInputLogMagic[8] = {'R', 'I', 'S', 'K', 'Y', '3', '2', 'I'};
+
+}  // namespace
+
+bool InputLogWriter::Open(std::string_view file) {
+  Close();
+  file_ = std::fopen(std::string(file).c_str(), "wb");
+  if (!file_) return false;
+  last_count_ = 0;
+  failed_ = false;
+  // write header
+  if (std::fwrite(kInputLogMagic, 1, sizeof(kInputLogMagic), file_) !=
+          sizeof(kInputLogMagic) ||
+      std::fwrite(&kInputLogVersion, sizeof(kInputLogVersion), 1, file_) !=
+          1) {
+    failed_ = true;
+  }
+  return !failed_;
+}
+
+bool InputLogWriter::Close() {
+  if (!file_) return !failed_;
+  if (std::fclose(file_)) failed_ = true;
+  file_ = nullptr;
+  return !failed_;
+}
+
+void InputLogWriter::Write(std::uint64_t count, std::uint64_t value) {
+  if (!file_ || failed_) return;
+  WriteULEB128(count - last_count_);
+  WriteULEB128(value);
+  last_count_ = count;
+  // flush every entry, so that the log survives crashes of emulator
+  if (std::fflush(file_)) failed_ = true;
+}
+
+void InputLogWriter::WriteULEB128(std::uint64_t value) {
+  do {
+    std::uint8_t byte = value & 0x7f;
+    value >>= 7;
+    if (value) byte |= 0x80;
+    if (std::fputc(byte, file_) == EOF) failed_ = true;
+  } while (value);
+}
+
+bool InputLogReader::Open(std::string_view file) {
+  Close();
+  file_ = std::fopen(std::string(file).c_str(), "rb");
+  if (!file_) return false;
+  last_count_ = 0;
+  failed_ = false;
+  // check header
+  char magic[sizeof(kInputLogMagic)];
+  std::uint32_t version;
+  if (std::fread(magic, 1, sizeof(magic), file_) != sizeof(magic) ||
+      std::fread(&version, sizeof(version), 1, file_) != 1 ||
+      std::memcmp(magic, kInputLogMagic, sizeof(magic)) ||
+      version != kInputLogVersion) {
+    failed_ = true;
+  }
+  return !failed_;
+}
+
+void InputLogReader::Close() {
+  if (file_) {
+    std::fclose(file_);
+    file_ = nullptr;
+  }
+}
+
+bool InputLogReader::Read(std::uint64_t count, std::uint64_t &value) {
+  if (!file_ || failed_) return false;
+  std::uint64_t delta;
+  if (!ReadULEB128(delta) || !ReadULEB128(value) ||
+      last_count_ + delta != count) {
+    failed_ = true;
+    return false;
+  }
+  last_count_ = count;
+  return true;
+}
+
+bool InputLogReader::Finish() {
+  if (!file_ || failed_) return !failed_;
+  // guest has read less input than recorded
+  if (std::fgetc(file_) != EOF) failed_ = true;
+  return !failed_;
+}
+
+bool InputLogReader::ReadULEB128(std::uint64_t &value) {
+  value = 0;
+  for (unsigned shift = 0; shift < 64; shift += 7) {
+    auto byte = std::fgetc(file_);
+    if (byte == EOF) return false;
+    value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) return true;
+  }
+  return false;
+}
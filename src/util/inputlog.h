@@ -0,0 +1,86 @@
+#ifndef RISKY32_UTIL_INPUTLOG_H_
+#define RISKY32_UTIL_INPUTLOG_H_
+
+#include <string_view>
+#include <cstdio>
+#include <cstdint>
+
+/*
+
+Layout of input log file (version 1):
+
+  header:
+    magic     char[8]     "RISKY32I"
+    version   u32         'kInputLogVersion' (host byte order)
+
+  entries (appended in order of reading):
+    delta     uleb128     retired instruction count since last entry
+    value     uleb128     input value
+
+Each entry records a nondeterministic input (e.g. a byte read from
+console) read by guest, so that the run can be reproduced bit-exactly.
+
+*/
+
+// version of input log file format
+constexpr std::uint32_t kInputLogVersion = 1;
+
+// input log writer (record mode)
+class InputLogWriter {
+ public:
+  InputLogWriter() : file_(nullptr), last_count_(0), failed_(false) {}
+  ~InputLogWriter() { Close(); }
+
+  // create log file and write header, returns false if failed
+  bool Open(std::string_view file);
+  // close log file, returns false if any error occurred
+  bool Close();
+
+  // append an input value read at specific retired instruction count
+  void Write(std::uint64_t count, std::uint64_t value);
+
+  // getters
+  // check if any error occurred
+  bool failed() const { return failed_; }
+
+ private:
+  // write an unsigned LEB128 number
+  void WriteULEB128(std::uint64_t value);
+
+  std::FILE *file_;
+  std::uint64_t last_count_;
+  bool failed_;
+};
+
+// input log reader (replay mode)
+class InputLogReader {
+ public:
+  InputLogReader() : file_(nullptr), last_count_(0), failed_(false) {}
+  ~InputLogReader() { Close(); }
+
+  // open log file and check header, returns false if failed
+  bool Open(std::string_view file);
+  // close log file
+  void Close();
+
+  // read the next input value, returns false if log has ended, or
+  // the value was not recorded at specific retired instruction count
+  bool Read(std::uint64_t count, std::uint64_t &value);
+  // check if all entries have been replayed, marks replay as diverged
+  // if there are entries left in log
+  bool Finish();
+
+  // getters
+  // check if any error occurred (e.g. replay diverged from log)
+  bool failed() const { return failed_; }
+
+ private:
+  // read an unsigned LEB128 number
+  bool ReadULEB128(std::uint64_t &value);
+
+  std::FILE *file_;
+  std::uint64_t last_count_;
+  bool failed_;
+};
+
+#endif  // RISKY32_UTIL_INPUTLOG_H_
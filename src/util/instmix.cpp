@@ -0,0 +1,67 @@
+#include "util/instmix.h"
+
+#include <fstream>
+#include <string>
+
+namespace {
+
+// names of instruction classes (in order of 'InstClass')
+constexpr const char *kClassNames[] = {
+    "alu", "mul", "div",
+    "load_byte", "load_half", "load_word",
+    "store_byte", "store_half", "store_word",
+    "amo", "branch_taken", "branch_not_taken", "jump",
+    "csr", "system", "fence", "trap", "other",
+};
+
+// names of privilege levels (indexed by level)
+constexpr const char *kPrivNames[] = {"user", "supervisor", "", "machine"};
+
+// print counts of all classes as a JSON object
+template <typename Counts>
+void PrintCounts(std::ostream &os, const Counts &counts,
+                 std::string_view indent) {
+  os << '{' << std::endl;
+  for (std::size_t i = 0; i < counts.size(); ++i) {
+    os << indent << "  \"" << kClassNames[i] << "\": " << counts[i];
+    if (i + 1 < counts.size()) os << ',';
+    os << std::endl;
+  }
+  os << indent << '}';
+}
+
+}  // namespace
+
+bool InstMixStats::WriteJSON(std::string_view file) const {
+  static_assert(sizeof(kClassNames) / sizeof(*kClassNames) == kClassCount);
+  std::ofstream ofs{std::string(file)};
+  if (!ofs) return false;
+  // get totals of all privilege levels
+  std::array<std::uint64_t, kClassCount> total = {};
+  std::uint64_t retired = 0;
+  for (const auto &counts : counts_) {
+    for (int i = 0; i < kClassCount; ++i) {
+      total[i] += counts[i];
+      if (i != kClassTrap) retired += counts[i];
+    }
+  }
+  // print JSON
+  ofs << '{' << std::endl;
+  ofs << "  \"retired\": " << retired << ',' << std::endl;
+  ofs << "  \"total\": ";
+  PrintCounts(ofs, total, "  ");
+  ofs << ',' << std::endl;
+  ofs << "  \"privilege\": {" << std::endl;
+  bool first = true;
+  for (std::size_t priv = 0; priv < counts_.size(); ++priv) {
+    // hypervisor mode is not implemented
+    if (!*kPrivNames[priv]) continue;
+    if (!first) ofs << ',' << std::endl;
+    first = false;
+    ofs << "    \"" << kPrivNames[priv] << "\": ";
+    PrintCounts(ofs, counts_[priv], "    ");
+  }
+  ofs << std::endl << "  }" << std::endl;
+  ofs << '}' << std::endl;
+  return static_cast<bool>(ofs);
+}
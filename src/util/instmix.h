@@ -0,0 +1,74 @@
+#ifndef RISKY32_UTIL_INSTMIX_H_
+#define RISKY32_UTIL_INSTMIX_H_
+
+#include <string_view>
+#include <array>
+#include <cstdint>
+
+#include "define/inst.h"
+
+// instruction mix statistics, counts retired instructions by class
+// and by privilege level
+// used as an instrumentation policy of the execution loop
+// (see 'Core::NextCycle')
+class InstMixStats {
+ public:
+  InstMixStats() : counts_({}) {}
+
+  // handle a retired instruction
+  void Retire(std::uint32_t pc, std::uint32_t inst_data,
+              std::uint32_t next_pc, std::uint32_t priv) {
+    ++counts_[priv & 0b11][Classify(pc, inst_data, next_pc)];
+  }
+  // handle a trap
+  void Trap(std::uint32_t priv) { ++counts_[priv & 0b11][kClassTrap]; }
+
+  // write statistics to file in JSON format, returns false if failed
+  bool WriteJSON(std::string_view file) const;
+
+ private:
+  // class of instruction
+  enum InstClass {
+    kClassALU, kClassMul, kClassDiv,
+    kClassLoadB, kClassLoadH, kClassLoadW,
+    kClassStoreB, kClassStoreH, kClassStoreW,
+    kClassAMO, kClassBranchTaken, kClassBranchNotTaken, kClassJump,
+    kClassCSR, kClassSystem, kClassFence, kClassTrap, kClassOther,
+    kClassCount,
+  };
+
+  // get class of retired instruction
+  static InstClass Classify(std::uint32_t pc, std::uint32_t inst_data,
+                            std::uint32_t next_pc) {
+    auto funct3 = (inst_data >> 12) & 0b111;
+    switch (inst_data & 0x7f) {
+      case kOp: {
+        if ((inst_data >> 25) != kRV32M) return kClassALU;
+        return funct3 < kDIV ? kClassMul : kClassDiv;
+      }
+      case kOpImm: case kLUI: case kAUIPC: return kClassALU;
+      case kLoad: {
+        if ((funct3 & 0b11) == 0b00) return kClassLoadB;
+        return (funct3 & 0b11) == 0b01 ? kClassLoadH : kClassLoadW;
+      }
+      case kStore: {
+        if (funct3 == kSB) return kClassStoreB;
+        return funct3 == kSH ? kClassStoreH : kClassStoreW;
+      }
+      case kAMO: return kClassAMO;
+      case kBranch: {
+        return next_pc != pc + 4 ? kClassBranchTaken
+                                 : kClassBranchNotTaken;
+      }
+      case kJAL: case kJALR: return kClassJump;
+      case kSystem: return funct3 ? kClassCSR : kClassSystem;
+      case kMiscMem: return kClassFence;
+      default: return kClassOther;
+    }
+  }
+
+  // counts of each privilege level & class
+  std::array<std::array<std::uint64_t, kClassCount>, 4> counts_;
+};
+
+#endif  // RISKY32_UTIL_INSTMIX_H_
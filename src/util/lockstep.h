@@ -0,0 +1,95 @@
+#ifndef RISKY32_UTIL_LOCKSTEP_H_
+#define RISKY32_UTIL_LOCKSTEP_H_
+
+#include <string_view>
+#include <cstdint>
+
+#include "define/inst.h"
+#include "util/commitlog.h"
+
+// lockstep differential checker
+// compares PC, instruction data and register write-back of every
+// retired instruction with a reference commit log, and stops at the
+// first divergence
+// instruction traces of Spike ('-l') also list instructions that raised
+// exceptions, these records are skipped if core traps at the same PC
+class LockstepChecker {
+ public:
+  LockstepChecker()
+      : checking_(false), diverged_(false), fetched_(false), checked_(0),
+        expected_({}), actual_({}) {}
+
+  // open reference commit log, returns false if failed
+  bool Open(std::string_view file) {
+    diverged_ = false;
+    fetched_ = false;
+    checked_ = 0;
+    checking_ = reader_.Open(file);
+    return checking_;
+  }
+
+  // check a retired instruction, 'rd_value' is the new value of 'rd'
+  void Retire(std::uint32_t pc, std::uint32_t inst_data,
+              std::uint32_t rd_value) {
+    if (!checking_ || !Fetch()) return;
+    fetched_ = false;
+    auto opcode = inst_data & 0x7f, rd = (inst_data >> 7) & 0x1f;
+    if (!rd || opcode == kStore || opcode == kBranch) rd = 0;
+    if (expected_.pc != pc || expected_.inst != inst_data ||
+        (expected_.has_wb && (expected_.rd != rd ||
+                              (rd && expected_.rd_value != rd_value)))) {
+      actual_ = {pc, inst_data, rd, rd ? rd_value : 0, true};
+      checking_ = false;
+      diverged_ = true;
+      return;
+    }
+    ++checked_;
+  }
+
+  // handle an exception raised by instruction at 'pc'
+  void Trap(std::uint32_t pc) {
+    if (!checking_ || !Fetch()) return;
+    if (!expected_.has_wb && expected_.pc == pc) fetched_ = false;
+  }
+
+  // getters
+  // check if diverged from reference log
+  bool diverged() const { return diverged_; }
+  // check if reached the end of reference log
+  bool log_ended() const { return !checking_ && !diverged_; }
+  // check if reference log is malformed
+  bool log_failed() const { return reader_.failed(); }
+  // count of matched instructions
+  std::uint64_t checked() const { return checked_; }
+  // expected & actual record of the diverged instruction
+  const CommitRecord &expected() const { return expected_; }
+  const CommitRecord &actual() const { return actual_; }
+
+ private:
+  // fetch the next record to 'expected_' if not fetched,
+  // returns false if reached the end of reference log
+  bool Fetch() {
+    if (fetched_) return true;
+    if (!reader_.Next(expected_)) {
+      checking_ = false;
+      return false;
+    }
+    fetched_ = true;
+    return true;
+  }
+
+  // reader of reference log
+  CommitLogReader reader_;
+  // set if still checking
+  bool checking_;
+  // set if diverged from reference log
+  bool diverged_;
+  // set if 'expected_' has been fetched but not checked
+  bool fetched_;
+  // count of checked instructions
+  std::uint64_t checked_;
+  // expected & actual record of the last checked instruction
+  CommitRecord expected_, actual_;
+};
+
+#endif  // RISKY32_UTIL_LOCKSTEP_H_
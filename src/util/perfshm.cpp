@@ -0,0 +1,146 @@
+#include "util/perfshm.h"
+
+#include <thread>
+#include <cstring>
+#include <ctime>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+// magic number of performance counter segment
+constexpr char kPerfShmMagic[8] = {'R', 'I', 'S', 'K', 'Y', '3', '2', 'P'};
+
+static_assert(std::atomic<std::uint32_t>::is_always_lock_free,
+              "sequence number must be lock-free in shared memory");
+
+// get name of shared memory object
+inline std::string GetShmName(std::string_view name) {
+  return name.size() && name[0] == '/' ? std::string(name)
+                                       : "/" + std::string(name);
+}
+
+// get current monotonic time in nanoseconds
+inline std::uint64_t GetMonotonicTime() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// update counters in segment with seqlock
+void WriteCounters(PerfShmSegment *seg, const PerfCounters &counters) {
+  auto seq = seg->seq.load(std::memory_order_relaxed);
+  seg->seq.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  std::memcpy(&seg->counters, &counters, sizeof(PerfCounters));
+  seg->seq.store(seq + 2, std::memory_order_release);
+}
+
+}  // namespace
+
+bool PerfShmWriter::Open(std::string_view name) {
+  Close();
+  name_ = GetShmName(name);
+  auto fd = shm_open(name_.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0644);
+  if (fd < 0) return false;
+  if (ftruncate(fd, sizeof(PerfShmSegment)) < 0) {
+    close(fd);
+    shm_unlink(name_.c_str());
+    return false;
+  }
+  auto seg = mmap(nullptr, sizeof(PerfShmSegment), PROT_READ | PROT_WRITE,
+                  MAP_SHARED, fd, 0);
+  close(fd);
+  if (seg == MAP_FAILED) {
+    shm_unlink(name_.c_str());
+    return false;
+  }
+  // initialize segment
+  seg_ = static_cast<PerfShmSegment *>(seg);
+  seg_->version = kPerfShmVersion;
+  seg_->pid = getpid();
+  seg_->seq.store(0, std::memory_order_relaxed);
+  last_ = {};
+  last_.start_time = last_.update_time = GetMonotonicTime();
+  WriteCounters(seg_, last_);
+  // write magic number at last, so that readers never see
+  // an uninitialized segment
+  std::atomic_thread_fence(std::memory_order_release);
+  std::memcpy(seg_->magic, kPerfShmMagic, sizeof(kPerfShmMagic));
+  return true;
+}
+
+void PerfShmWriter::Close() {
+  if (!seg_) return;
+  last_.stopped = 1;
+  WriteCounters(seg_, last_);
+  munmap(seg_, sizeof(PerfShmSegment));
+  shm_unlink(name_.c_str());
+  seg_ = nullptr;
+}
+
+void PerfShmWriter::Publish(PerfCounters counters) {
+  auto now = GetMonotonicTime(), elapsed = now - last_.update_time;
+  counters.start_time = last_.start_time;
+  counters.update_time = now;
+  counters.restarts = last_.restarts;
+  if (counters.retired < last_.retired) {
+    // machine has been restored, keep the last value
+    ++counters.restarts;
+    counters.mips = last_.mips;
+  }
+  else {
+    // keep the last value if nothing retired (e.g. the final update)
+    auto retired = counters.retired - last_.retired;
+    counters.mips = elapsed && retired ? retired * 1000.0 / elapsed
+                                       : last_.mips;
+  }
+  WriteCounters(seg_, counters);
+  last_ = counters;
+}
+
+bool PerfShmReader::Open(std::string_view name) {
+  Close();
+  auto fd = shm_open(GetShmName(name).c_str(), O_RDONLY, 0);
+  if (fd < 0) return false;
+  struct stat st;
+  if (fstat(fd, &st) < 0 ||
+      static_cast<std::size_t>(st.st_size) < sizeof(PerfShmSegment)) {
+    close(fd);
+    return false;
+  }
+  auto seg = mmap(nullptr, sizeof(PerfShmSegment), PROT_READ, MAP_SHARED,
+                  fd, 0);
+  close(fd);
+  if (seg == MAP_FAILED) return false;
+  seg_ = static_cast<const PerfShmSegment *>(seg);
+  // check magic number & version
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (std::memcmp(seg_->magic, kPerfShmMagic, sizeof(kPerfShmMagic)) ||
+      seg_->version != kPerfShmVersion) {
+    Close();
+    return false;
+  }
+  return true;
+}
+
+void PerfShmReader::Close() {
+  if (!seg_) return;
+  munmap(const_cast<PerfShmSegment *>(seg_), sizeof(PerfShmSegment));
+  seg_ = nullptr;
+}
+
+void PerfShmReader::Read(PerfCounters &counters) const {
+  for (;;) {
+    auto seq = seg_->seq.load(std::memory_order_acquire);
+    if (!(seq & 1)) {
+      std::memcpy(&counters, &seg_->counters, sizeof(PerfCounters));
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (seg_->seq.load(std::memory_order_relaxed) == seq) return;
+    }
+    std::this_thread::yield();
+  }
+}
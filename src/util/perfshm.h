@@ -0,0 +1,110 @@
+#ifndef RISKY32_UTIL_PERFSHM_H_
+#define RISKY32_UTIL_PERFSHM_H_
+
+#include <string>
+#include <string_view>
+#include <atomic>
+#include <cstdint>
+
+/*
+
+Layout of performance counter segment (version 1, POSIX shared memory,
+host byte order):
+
+  magic       char[8]     "RISKY32P"
+  version     u32         'kPerfShmVersion'
+  pid         u32         process id of emulator
+  seq         u32         sequence number of seqlock
+                          (odd while counters are being updated)
+  padding     u32
+  counters    PerfCounters
+
+Writer increases 'seq' before and after updating counters, readers
+retry if 'seq' is odd or changed while copying counters.
+
+*/
+
+// version of performance counter segment
+constexpr std::uint32_t kPerfShmVersion = 1;
+
+// performance counters of emulator
+struct PerfCounters {
+  // monotonic time (ns) of start & last update
+  std::uint64_t start_time;
+  std::uint64_t update_time;
+  // retired instructions
+  std::uint64_t retired;
+  // instructions per microsecond in the last quantum
+  double mips;
+  // taken exceptions & interrupts
+  std::uint64_t exceptions;
+  std::uint64_t interrupts;
+  // page table walks of MMU (there is no TLB)
+  std::uint64_t page_walks;
+  // bytes read from/written to console
+  std::uint64_t io_input;
+  std::uint64_t io_output;
+  // non-zero if emulator has stopped
+  std::uint64_t stopped;
+  // times of counters going backwards (e.g. restored from checkpoint),
+  // rates are meaningless across restarts
+  std::uint64_t restarts;
+};
+
+// shared memory segment of performance counters
+struct PerfShmSegment {
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t pid;
+  std::atomic<std::uint32_t> seq;
+  std::uint32_t padding;
+  PerfCounters counters;
+};
+
+// writer of performance counter segment (used by emulator)
+class PerfShmWriter {
+ public:
+  PerfShmWriter() : seg_(nullptr) {}
+  ~PerfShmWriter() { Close(); }
+
+  // create shared memory segment, returns false if failed
+  bool Open(std::string_view name);
+  // mark emulator as stopped and remove segment
+  void Close();
+
+  // update all counters, computes 'start_time', 'update_time' & 'mips'
+  void Publish(PerfCounters counters);
+
+  // getters
+  bool is_open() const { return seg_; }
+
+ private:
+  PerfShmSegment *seg_;
+  // name of segment
+  std::string name_;
+  // counters of the last update
+  PerfCounters last_;
+};
+
+// reader of performance counter segment (used by monitors)
+class PerfShmReader {
+ public:
+  PerfShmReader() : seg_(nullptr) {}
+  ~PerfShmReader() { Close(); }
+
+  // open an existing segment, returns false if failed
+  bool Open(std::string_view name);
+  // unmap segment
+  void Close();
+
+  // read a consistent snapshot of counters
+  void Read(PerfCounters &counters) const;
+
+  // getters
+  std::uint32_t pid() const { return seg_->pid; }
+
+ private:
+  const PerfShmSegment *seg_;
+};
+
+#endif  // RISKY32_UTIL_PERFSHM_H_
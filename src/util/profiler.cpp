@@ -0,0 +1,126 @@
+#include "util/profiler.h"
+
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <cassert>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+
+// get length of mapping that can hold counts of 'size' bytes
+inline std::size_t GetMapLength(std::uint32_t size) {
+  static const std::size_t page_size = sysconf(_SC_PAGESIZE);
+  auto len = (size / 4) * sizeof(std::uint64_t);
+  return (len + page_size - 1) & ~(page_size - 1);
+}
+
+// print a line of report
+void PrintLine(std::ostream &os, std::uint64_t count, std::uint64_t total) {
+  os << std::setw(14) << std::setfill(' ') << std::dec << count << "  ";
+  os << std::setw(7) << std::fixed << std::setprecision(2)
+     << (total ? count * 100.0 / total : 0.0) << "%  ";
+}
+
+}  // namespace
+
+Profiler::~Profiler() {
+  for (const auto &region : regions_) {
+    munmap(region.counts, GetMapLength(region.size));
+  }
+}
+
+void Profiler::AddRegion(std::uint32_t base, std::uint32_t size) {
+  assert(!(base & 0b11) && !(size & 0b11));
+  if (!size) return;
+  auto counts = mmap(nullptr, GetMapLength(size), PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  assert(counts != MAP_FAILED);
+  regions_.push_back({base, size, static_cast<std::uint64_t *>(counts)});
+  // pointers to regions may be invalidated
+  last_ = &empty_;
+}
+
+void Profiler::CountSlow(std::uint32_t pc) {
+  for (auto &region : regions_) {
+    auto ofs = pc - region.base;
+    if (ofs < region.size) {
+      last_ = &region;
+      ++region.counts[ofs >> 2];
+      return;
+    }
+  }
+  ++other_count_;
+}
+
+bool Profiler::WriteReport(std::string_view file,
+                           const SymbolTable &symbols) const {
+  std::ofstream ofs{std::string(file)};
+  if (!ofs) return false;
+  // collect all hit addresses
+  std::vector<std::pair<std::uint32_t, std::uint64_t>> hits;
+  std::uint64_t total = other_count_;
+  for (const auto &region : regions_) {
+    for (std::uint32_t i = 0; i < region.size / 4; ++i) {
+      if (!region.counts[i]) continue;
+      hits.push_back({region.base + i * 4, region.counts[i]});
+      total += region.counts[i];
+    }
+  }
+  // roll up by function
+  std::sort(hits.begin(), hits.end());
+  std::vector<std::pair<const SymbolTable::Symbol *, std::uint64_t>> funcs;
+  std::uint64_t unknown_count = other_count_;
+  for (const auto &[addr, count] : hits) {
+    auto sym = symbols.Find(addr);
+    if (!sym) {
+      unknown_count += count;
+    }
+    else if (!funcs.empty() && funcs.back().first == sym) {
+      // hits of the same function are adjacent
+      funcs.back().second += count;
+    }
+    else {
+      funcs.push_back({sym, count});
+    }
+  }
+  // sort by count, and then by address
+  auto cmp = [](const auto &lhs, const auto &rhs) {
+    return lhs.second > rhs.second;
+  };
+  std::stable_sort(hits.begin(), hits.end(), cmp);
+  std::stable_sort(funcs.begin(), funcs.end(), cmp);
+  // print flat profile
+  ofs << "Flat profile (" << total << " retired instructions):" << std::endl;
+  ofs << std::endl;
+  ofs << "         count  percent   address  symbol" << std::endl;
+  for (const auto &[addr, count] : hits) {
+    PrintLine(ofs, count, total);
+    ofs << std::setw(8) << std::setfill('0') << std::hex << addr;
+    auto name = symbols.Symbolize(addr);
+    if (!name.empty()) ofs << "  " << name;
+    ofs << std::endl;
+  }
+  if (other_count_) {
+    PrintLine(ofs, other_count_, total);
+    ofs << "(outside of memories)" << std::endl;
+  }
+  // print per-function rollup
+  ofs << std::endl;
+  ofs << "Functions:" << std::endl;
+  ofs << std::endl;
+  ofs << "         count  percent  function" << std::endl;
+  for (const auto &[sym, count] : funcs) {
+    PrintLine(ofs, count, total);
+    ofs << symbols.GetName(*sym) << std::endl;
+  }
+  if (unknown_count) {
+    PrintLine(ofs, unknown_count, total);
+    ofs << "(unknown)" << std::endl;
+  }
+  return static_cast<bool>(ofs);
+}
@@ -0,0 +1,62 @@
+#ifndef RISKY32_UTIL_PROFILER_H_
+#define RISKY32_UTIL_PROFILER_H_
+
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "util/symtab.h"
+
+// instruction-level execution profiler
+// retired instructions are counted in a dense array of each code region,
+// indexed by '(pc - base) / 4', so that counting needs no hashing
+// arrays are mapped lazily, only touched pages take physical memory
+class Profiler {
+ public:
+  Profiler() : last_(&empty_), empty_({0, 0, nullptr}), other_count_(0) {}
+  ~Profiler();
+  // arrays are owned by profiler, so copying is not allowed
+  Profiler(const Profiler &) = delete;
+  Profiler &operator=(const Profiler &) = delete;
+
+  // add a code region to be profiled
+  void AddRegion(std::uint32_t base, std::uint32_t size);
+  // count a retired instruction at specific PC
+  void Count(std::uint32_t pc) {
+    // most instructions are in the same region as the last one
+    auto ofs = pc - last_->base;
+    if (ofs < last_->size) {
+      ++last_->counts[ofs >> 2];
+    }
+    else {
+      CountSlow(pc);
+    }
+  }
+  // write sorted flat profile & per-function rollup to file,
+  // returns false if failed
+  bool WriteReport(std::string_view file, const SymbolTable &symbols) const;
+
+ private:
+  // code region
+  struct Region {
+    // base address & size in bytes
+    std::uint32_t base, size;
+    // retired instruction count of each word
+    std::uint64_t *counts;
+  };
+
+  // count a retired instruction outside the last region
+  void CountSlow(std::uint32_t pc);
+
+  // all regions
+  std::vector<Region> regions_;
+  // the last hit region
+  Region *last_;
+  // placeholder of region before any hits
+  Region empty_;
+  // count of instructions outside all regions
+  std::uint64_t other_count_;
+};
+
+#endif  // RISKY32_UTIL_PROFILER_H_
@@ -0,0 +1,63 @@
+#include "util/selfprof.h"
+
+#ifdef RISKY32_SELF_PROFILE
+
+#include <iomanip>
+
+namespace {
+
+// names of all scopes
+constexpr const char *kScopeNames[kSelfProfileCount] = {
+  "run", "fetch", "execute", "translate", "bus-decode", "device",
+  "write-back",
+};
+
+// count of timers used to measure overhead of a timer
+constexpr int kCalibrateCount = 100000;
+
+}  // namespace
+
+SelfProfileTimer::Entry SelfProfileTimer::entries_[kSelfProfileCount];
+SelfProfileTimer *SelfProfileTimer::current_ = nullptr;
+
+void SelfProfileTimer::PrintReport(std::ostream &os) {
+  // measure overhead of an empty timer
+  std::uint64_t overhead;
+  {
+    auto entry = entries_[kSelfProfileRun];
+    std::uint64_t children;
+    {
+      SelfProfileTimer timer(kSelfProfileRun);
+      for (int i = 0; i < kCalibrateCount; ++i) {
+        SelfProfileTimer empty(kSelfProfileRun);
+      }
+      children = timer.children_;
+    }
+    auto total = entries_[kSelfProfileRun].total - entry.total - children;
+    overhead = total / kCalibrateCount;
+    entries_[kSelfProfileRun] = entry;
+  }
+  // get total self ticks
+  std::uint64_t total = 0;
+  for (const auto &entry : entries_) total += entry.total - entry.children;
+  // print report
+  os << "self-profile (ticks, " << overhead
+     << " ticks of overhead per timer):" << std::endl;
+  os << std::setw(12) << std::left << "scope" << std::right
+     << std::setw(14) << "calls" << std::setw(16) << "inclusive"
+     << std::setw(16) << "self" << std::setw(9) << "self%"
+     << std::setw(14) << "self/call" << std::endl;
+  for (int i = 0; i < kSelfProfileCount; ++i) {
+    const auto &entry = entries_[i];
+    auto self = entry.total - entry.children;
+    os << std::setw(12) << std::left << kScopeNames[i] << std::right
+       << std::setw(14) << entry.calls << std::setw(16) << entry.total
+       << std::setw(16) << self << std::setw(8) << std::fixed
+       << std::setprecision(2) << (total ? self * 100.0 / total : 0.0)
+       << '%' << std::setw(14) << std::setprecision(1)
+       << (entry.calls ? static_cast<double>(self) / entry.calls : 0.0)
+       << std::endl;
+  }
+}
+
+#endif  // RISKY32_SELF_PROFILE
@@ -0,0 +1,95 @@
+#ifndef RISKY32_UTIL_SELFPROF_H_
+#define RISKY32_UTIL_SELFPROF_H_
+
+// host-side self-profiling of emulator subsystems
+// enabled by CMake option 'RISKY32_SELF_PROFILE', all timers are
+// compiled out otherwise
+//
+// usage: put 'SELF_PROFILE_SCOPE(Name);' at the beginning of a block,
+// time from there to the end of the block will be counted to scope
+// 'SelfProfileScope::kName', excluding time of nested scopes
+
+#ifdef RISKY32_SELF_PROFILE
+
+#include <ostream>
+#include <cstdint>
+#include <cstddef>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+// subsystems of emulator
+enum SelfProfileScope {
+  kSelfProfileRun,        // main loop (timer update, etc.)
+  kSelfProfileFetch,      // instruction fetch ('MMU::ReadInst')
+  kSelfProfileExecute,    // decode, dispatch & execute ('Core::Execute')
+  kSelfProfileTranslate,  // address translation of MMU
+  kSelfProfileBusDecode,  // peripheral lookup of bus
+  kSelfProfileDevice,     // read/write handlers of peripherals
+  kSelfProfileWriteBack,  // write-back & interrupt checks
+  kSelfProfileCount,
+};
+
+// scoped timer of self-profiling
+class SelfProfileTimer {
+ public:
+  explicit SelfProfileTimer(SelfProfileScope scope)
+      : scope_(scope), parent_(current_), children_(0) {
+    current_ = this;
+    start_ = ReadTimestamp();
+  }
+  ~SelfProfileTimer() {
+    auto elapsed = ReadTimestamp() - start_;
+    auto &entry = entries_[scope_];
+    ++entry.calls;
+    entry.total += elapsed;
+    entry.children += children_;
+    if (parent_) parent_->children_ += elapsed;
+    current_ = parent_;
+  }
+
+  // print totals of all scopes to stream
+  static void PrintReport(std::ostream &os);
+
+ private:
+  // totals of a scope
+  struct Entry {
+    std::uint64_t calls;
+    // inclusive ticks, and ticks of nested scopes
+    std::uint64_t total, children;
+  };
+
+  // read timestamp counter (TSC ticks, or nanoseconds on non-x86 hosts)
+  static std::uint64_t ReadTimestamp() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    using namespace std::chrono;
+    return duration_cast<nanoseconds>(
+               steady_clock::now().time_since_epoch()).count();
+#endif
+  }
+
+  // totals of all scopes
+  static Entry entries_[kSelfProfileCount];
+  // innermost active timer
+  static SelfProfileTimer *current_;
+
+  SelfProfileScope scope_;
+  SelfProfileTimer *parent_;
+  std::uint64_t start_, children_;
+};
+
+#define SELF_PROFILE_SCOPE(name) \
+  SelfProfileTimer self_profile_timer_(kSelfProfile##name)
+
+#else  // RISKY32_SELF_PROFILE
+
+#define SELF_PROFILE_SCOPE(name) static_cast<void>(0)
+
+#endif  // RISKY32_SELF_PROFILE
+
+#endif  // RISKY32_UTIL_SELFPROF_H_
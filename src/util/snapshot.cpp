@@ -0,0 +1,177 @@
+#include "util/snapshot.h"
+
+#include <string>
+#include <cstring>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+
+// magic number of snapshot file
+constexpr char kSnapshotMagic[8] = {'R', 'I', 'S', 'K', 'Y', '3', '2', 'S'};
+
+// get the next aligned offset
+inline std::uint64_t AlignOffset(std::uint64_t offset) {
+  return (offset + kSnapshotAlign - 1) & ~std::uint64_t(kSnapshotAlign - 1);
+}
+
+}  // namespace
+
+bool SnapshotWriter::Open(std::string_view file) {
+  Close();
+  file_ = std::fopen(std::string(file).c_str(), "wb");
+  if (!file_) return false;
+  offset_ = 0;
+  failed_ = false;
+  // write header
+  WriteData(kSnapshotMagic, sizeof(kSnapshotMagic));
+  Write(kSnapshotVersion);
+  Write(kSnapshotAlign);
+  return !failed_;
+}
+
+bool SnapshotWriter::Open(std::vector<std::uint8_t> &buffer) {
+  Close();
+  buffer_ = &buffer;
+  buffer_->clear();
+  offset_ = 0;
+  failed_ = false;
+  // write header
+  WriteData(kSnapshotMagic, sizeof(kSnapshotMagic));
+  Write(kSnapshotVersion);
+  Write(kSnapshotAlign);
+  return !failed_;
+}
+
+bool SnapshotWriter::Close() {
+  buffer_ = nullptr;
+  if (!file_) return !failed_;
+  if (std::fclose(file_)) failed_ = true;
+  file_ = nullptr;
+  return !failed_;
+}
+
+void SnapshotWriter::BeginSection(std::string_view tag) {
+  char buf[4] = {' ', ' ', ' ', ' '};
+  std::memcpy(buf, tag.data(), tag.size() < 4 ? tag.size() : 4);
+  WriteData(buf, sizeof(buf));
+}
+
+void SnapshotWriter::WriteData(const void *data, std::size_t size) {
+  if (failed_) return;
+  if (buffer_) {
+    auto bytes = static_cast<const std::uint8_t *>(data);
+    buffer_->insert(buffer_->end(), bytes, bytes + size);
+  }
+  else if (!file_ || std::fwrite(data, 1, size, file_) != size) {
+    failed_ = true;
+  }
+  offset_ += size;
+}
+
+void SnapshotWriter::WritePages(const void *data, std::size_t size) {
+  PadToAlign();
+  WriteData(data, size);
+  PadToAlign();
+}
+
+void SnapshotWriter::PadToAlign() {
+  static const char zeros[256] = {};
+  auto len = AlignOffset(offset_) - offset_;
+  while (len) {
+    auto cur = len < sizeof(zeros) ? len : sizeof(zeros);
+    WriteData(zeros, cur);
+    len -= cur;
+  }
+}
+
+bool SnapshotReader::Open(std::string_view file) {
+  Close();
+  file_ = std::fopen(std::string(file).c_str(), "rb");
+  if (!file_) return false;
+  offset_ = 0;
+  failed_ = false;
+  return CheckHeader();
+}
+
+bool SnapshotReader::Open(const std::vector<std::uint8_t> &buffer) {
+  Close();
+  buffer_ = &buffer;
+  offset_ = 0;
+  failed_ = false;
+  return CheckHeader();
+}
+
+bool SnapshotReader::CheckHeader() {
+  char magic[sizeof(kSnapshotMagic)];
+  std::uint32_t version, align;
+  if (!ReadData(magic, sizeof(magic)) || !Read(version) || !Read(align)) {
+    return false;
+  }
+  if (std::memcmp(magic, kSnapshotMagic, sizeof(magic)) ||
+      version != kSnapshotVersion || align != kSnapshotAlign) {
+    failed_ = true;
+    return false;
+  }
+  return true;
+}
+
+void SnapshotReader::Close() {
+  buffer_ = nullptr;
+  if (file_) {
+    std::fclose(file_);
+    file_ = nullptr;
+  }
+}
+
+bool SnapshotReader::CheckSection(std::string_view tag) {
+  char buf[4], expected[4] = {' ', ' ', ' ', ' '};
+  std::memcpy(expected, tag.data(), tag.size() < 4 ? tag.size() : 4);
+  if (!ReadData(buf, sizeof(buf))) return false;
+  if (std::memcmp(buf, expected, sizeof(buf))) failed_ = true;
+  return !failed_;
+}
+
+bool SnapshotReader::ReadData(void *data, std::size_t size) {
+  if (failed_) return false;
+  if (buffer_) {
+    if (offset_ + size > buffer_->size()) {
+      failed_ = true;
+    }
+    else {
+      std::memcpy(data, buffer_->data() + offset_, size);
+    }
+  }
+  else if (!file_ || std::fread(data, 1, size, file_) != size) {
+    failed_ = true;
+  }
+  offset_ += size;
+  return !failed_;
+}
+
+bool SnapshotReader::ReadPages(void *data, std::size_t size,
+                               bool mappable) {
+  if (!SkipToAlign()) return false;
+  // try to map the page block into memory
+  static const auto page_size = sysconf(_SC_PAGESIZE);
+  if (file_ && mappable && size && !(offset_ % page_size)) {
+    auto len = (size + page_size - 1) & ~(page_size - 1);
+    auto ret = mmap(data, len, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_FIXED, fileno(file_), offset_);
+    if (ret != MAP_FAILED) {
+      offset_ += size;
+      return SkipToAlign();
+    }
+  }
+  // fallback to normal read
+  if (!ReadData(data, size)) return false;
+  return SkipToAlign();
+}
+
+bool SnapshotReader::SkipToAlign() {
+  if (failed_) return false;
+  offset_ = AlignOffset(offset_);
+  if (file_ && std::fseek(file_, offset_, SEEK_SET)) failed_ = true;
+  return !failed_;
+}
@@ -0,0 +1,123 @@
+#ifndef RISKY32_UTIL_SNAPSHOT_H_
+#define RISKY32_UTIL_SNAPSHOT_H_
+
+#include <string_view>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+#include <cstddef>
+
+/*
+
+Layout of snapshot file (version 4, host byte order):
+
+  header:
+    magic     char[8]     "RISKY32S"
+    version   u32         'kSnapshotVersion'
+    align     u32         alignment of page blocks ('kSnapshotAlign')
+
+  sections (written by each component in a fixed order):
+    tag       char[4]     name of section, e.g. "CORE", "RAM "
+    data      ...         fields of component
+
+  page blocks (e.g. RAM contents) are padded to 'align' bytes on both
+  sides, so that they can be mapped back into memory via 'mmap'.
+
+Snapshots can also be written to/read from memory buffers, which is
+used by in-process checkpoints.
+
+*/
+
+// version of snapshot file format
+constexpr std::uint32_t kSnapshotVersion = 4;
+// alignment of page blocks in snapshot file
+// (covers hosts with up to 64KB pages)
+constexpr std::uint32_t kSnapshotAlign = 0x10000;
+
+// snapshot file writer
+class SnapshotWriter {
+ public:
+  SnapshotWriter()
+      : file_(nullptr), buffer_(nullptr), offset_(0), failed_(false) {}
+  ~SnapshotWriter() { Close(); }
+
+  // open snapshot file and write header, returns false if failed
+  bool Open(std::string_view file);
+  // clear memory buffer and write header to it
+  bool Open(std::vector<std::uint8_t> &buffer);
+  // close snapshot file, returns false if any error occurred
+  bool Close();
+
+  // begin a new section
+  void BeginSection(std::string_view tag);
+  // write raw data
+  void WriteData(const void *data, std::size_t size);
+  // write page block (aligned to 'kSnapshotAlign')
+  void WritePages(const void *data, std::size_t size);
+
+  // write a trivially copyable value
+  template <typename T>
+  void Write(const T &value) {
+    WriteData(&value, sizeof(T));
+  }
+
+  // getters
+  // check if any error occurred
+  bool failed() const { return failed_; }
+
+ private:
+  // pad file with zeros to the next aligned offset
+  void PadToAlign();
+
+  std::FILE *file_;
+  std::vector<std::uint8_t> *buffer_;
+  std::uint64_t offset_;
+  bool failed_;
+};
+
+// snapshot file reader
+class SnapshotReader {
+ public:
+  SnapshotReader()
+      : file_(nullptr), buffer_(nullptr), offset_(0), failed_(false) {}
+  ~SnapshotReader() { Close(); }
+
+  // open snapshot file and check header, returns false if failed
+  bool Open(std::string_view file);
+  // open memory buffer and check header, returns false if failed
+  bool Open(const std::vector<std::uint8_t> &buffer);
+  // close snapshot file
+  void Close();
+
+  // check tag of next section, returns false if mismatched
+  bool CheckSection(std::string_view tag);
+  // read raw data
+  bool ReadData(void *data, std::size_t size);
+  // read page block to 'data'
+  // if 'mappable' is true, 'data' must be page aligned, and the block
+  // will be mapped as private copy-on-write pages of snapshot file
+  bool ReadPages(void *data, std::size_t size, bool mappable);
+
+  // read a trivially copyable value
+  template <typename T>
+  bool Read(T &value) {
+    return ReadData(&value, sizeof(T));
+  }
+
+  // getters
+  // check if any error occurred
+  bool failed() const { return failed_; }
+
+ private:
+  // check header of snapshot
+  bool CheckHeader();
+  // skip to the next aligned offset
+  bool SkipToAlign();
+
+  std::FILE *file_;
+  const std::vector<std::uint8_t> *buffer_;
+  std::uint64_t offset_;
+  bool failed_;
+};
+
+#endif  // RISKY32_UTIL_SNAPSHOT_H_
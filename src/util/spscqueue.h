@@ -0,0 +1,52 @@
+#ifndef RISKY32_UTIL_SPSCQUEUE_H_
+#define RISKY32_UTIL_SPSCQUEUE_H_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+// lock-free bounded queue with a single producer and a single consumer
+// each side caches the last seen index of the other side, so that
+// shared indices are only read when the queue seems full or empty
+template <typename T, std::size_t N>
+class SPSCQueue {
+ public:
+  static_assert(N && !(N & (N - 1)), "size must be power of 2");
+
+  SPSCQueue() : head_(0), tail_(0), head_cache_(0), tail_cache_(0) {}
+
+  // push an item (producer only), returns false if full
+  bool Push(const T &item) {
+    auto tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_cache_ == N) {
+      head_cache_ = head_.load(std::memory_order_acquire);
+      if (tail - head_cache_ == N) return false;
+    }
+    items_[tail & (N - 1)] = item;
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // pop an item (consumer only), returns false if empty
+  bool Pop(T &item) {
+    auto head = head_.load(std::memory_order_relaxed);
+    if (head == tail_cache_) {
+      tail_cache_ = tail_.load(std::memory_order_acquire);
+      if (head == tail_cache_) return false;
+    }
+    item = items_[head & (N - 1)];
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+ private:
+  std::array<T, N> items_;
+  // indices are placed in different cache lines to avoid false sharing
+  alignas(64) std::atomic<std::size_t> head_;
+  alignas(64) std::atomic<std::size_t> tail_;
+  // index cache of producer & consumer
+  alignas(64) std::size_t head_cache_;
+  alignas(64) std::size_t tail_cache_;
+};
+
+#endif  // RISKY32_UTIL_SPSCQUEUE_H_
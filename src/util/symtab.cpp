@@ -0,0 +1,133 @@
+#include "util/symtab.h"
+
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <iterator>
+#include <algorithm>
+#include <cstring>
+
+#include <elf.h>
+
+namespace {
+
+// check if the symbol should be kept in symbol table
+inline bool IsUsefulSymbol(const Elf32_Sym &sym, std::string_view name) {
+  auto type = ELF32_ST_TYPE(sym.st_info);
+  if (sym.st_shndx == SHN_UNDEF || sym.st_shndx == SHN_ABS) return false;
+  if (type == STT_SECTION || type == STT_FILE) return false;
+  // skip mapping symbols & local labels generated by assembler
+  return !name.empty() && name[0] != '$' && name.substr(0, 2) != ".L";
+}
+
+}  // namespace
+
+bool SymbolTable::LoadELF(std::string_view file) {
+  Clear();
+  // read the whole file
+  std::ifstream ifs(std::string(file), std::ios::binary);
+  if (!ifs.is_open()) return false;
+  std::vector<char> data{std::istreambuf_iterator<char>(ifs),
+                         std::istreambuf_iterator<char>()};
+  // check ELF header
+  Elf32_Ehdr ehdr;
+  if (data.size() < sizeof(ehdr)) return false;
+  std::memcpy(&ehdr, data.data(), sizeof(ehdr));
+  if (std::memcmp(ehdr.e_ident, ELFMAG, SELFMAG) ||
+      ehdr.e_ident[EI_CLASS] != ELFCLASS32 ||
+      ehdr.e_ident[EI_DATA] != ELFDATA2LSB ||
+      ehdr.e_shentsize != sizeof(Elf32_Shdr) ||
+      ehdr.e_shoff + std::uint64_t(ehdr.e_shnum) * sizeof(Elf32_Shdr) >
+          data.size()) {
+    return false;
+  }
+  // read all section headers
+  std::vector<Elf32_Shdr> shdrs(ehdr.e_shnum);
+  std::memcpy(shdrs.data(), data.data() + ehdr.e_shoff,
+              shdrs.size() * sizeof(Elf32_Shdr));
+  auto in_file = [&data](const Elf32_Shdr &shdr) {
+    return shdr.sh_offset + std::uint64_t(shdr.sh_size) <= data.size();
+  };
+  // find symbol table & string table
+  std::vector<Symbol> syms;
+  for (const auto &shdr : shdrs) {
+    if (shdr.sh_type != SHT_SYMTAB || shdr.sh_link >= shdrs.size()) {
+      continue;
+    }
+    const auto &strtab = shdrs[shdr.sh_link];
+    if (!in_file(shdr) || !in_file(strtab)) {
+      Clear();
+      return false;
+    }
+    std::string_view strs(data.data() + strtab.sh_offset, strtab.sh_size);
+    // read all symbols
+    for (std::uint32_t ofs = 0; ofs + sizeof(Elf32_Sym) <= shdr.sh_size;
+         ofs += sizeof(Elf32_Sym)) {
+      Elf32_Sym sym;
+      std::memcpy(&sym, data.data() + shdr.sh_offset + ofs, sizeof(sym));
+      if (sym.st_name >= strs.size()) continue;
+      auto name = strs.substr(sym.st_name);
+      name = name.substr(0, name.find('\0'));
+      if (!IsUsefulSymbol(sym, name)) continue;
+      // symbols are section relative in relocatable files
+      auto addr = sym.st_value;
+      if (ehdr.e_type == ET_REL && sym.st_shndx < shdrs.size()) {
+        addr += shdrs[sym.st_shndx].sh_addr;
+      }
+      // add to string pool
+      syms.push_back({addr, sym.st_size,
+                      static_cast<std::uint32_t>(names_.size())});
+      names_.append(name);
+      names_.push_back('\0');
+      if (name.size() > max_name_len_) max_name_len_ = name.size();
+    }
+  }
+  // sort by address, prefer sized symbols if addresses are the same
+  std::stable_sort(syms.begin(), syms.end(),
+                   [](const Symbol &lhs, const Symbol &rhs) {
+                     return lhs.addr < rhs.addr ||
+                            (lhs.addr == rhs.addr && lhs.size > rhs.size);
+                   });
+  // build address index & name hashmap
+  for (const auto &sym : syms) {
+    name_map_.insert({GetName(sym), sym.addr});
+    if (!addrs_.empty() && addrs_.back() == sym.addr) continue;
+    addrs_.push_back(sym.addr);
+    syms_.push_back(sym);
+  }
+  return true;
+}
+
+void SymbolTable::Clear() {
+  addrs_.clear();
+  syms_.clear();
+  names_.clear();
+  name_map_.clear();
+  max_name_len_ = 0;
+}
+
+const SymbolTable::Symbol *SymbolTable::Find(std::uint32_t addr) const {
+  // find the last symbol not after the address
+  auto it = std::upper_bound(addrs_.begin(), addrs_.end(), addr);
+  if (it == addrs_.begin()) return nullptr;
+  const auto &sym = syms_[it - addrs_.begin() - 1];
+  if (sym.size && addr - sym.addr >= sym.size) return nullptr;
+  return &sym;
+}
+
+bool SymbolTable::GetAddr(std::string_view name,
+                          std::uint32_t &addr) const {
+  auto it = name_map_.find(name);
+  if (it == name_map_.end()) return false;
+  addr = it->second;
+  return true;
+}
+
+std::string SymbolTable::Symbolize(std::uint32_t addr) const {
+  auto sym = Find(addr);
+  if (!sym) return "";
+  std::ostringstream oss;
+  oss << GetName(*sym);
+  if (addr != sym->addr) oss << "+0x" << std::hex << addr - sym->addr;
+  return oss.str();
+}
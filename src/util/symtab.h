@@ -0,0 +1,68 @@
+#ifndef RISKY32_UTIL_SYMTAB_H_
+#define RISKY32_UTIL_SYMTAB_H_
+
+#include <string_view>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+// symbol table loaded from '.symtab' section of ELF file
+// addresses are kept in a sorted array separated from other fields,
+// so that address lookups only touch a compact array
+class SymbolTable {
+ public:
+  // information of symbol
+  struct Symbol {
+    // start address
+    std::uint32_t addr;
+    // size in bytes (0 if unknown, covers up to the next symbol)
+    std::uint32_t size;
+    // offset of name in string pool
+    std::uint32_t name;
+  };
+
+  SymbolTable() : max_name_len_(0) {}
+  // names in hashmap refer to string pool, so copying is not allowed
+  SymbolTable(const SymbolTable &) = delete;
+  SymbolTable &operator=(const SymbolTable &) = delete;
+
+  // load symbols from ELF file, returns false if failed
+  bool LoadELF(std::string_view file);
+  // remove all symbols
+  void Clear();
+
+  // find symbol that contains specific address, returns null if not found
+  const Symbol *Find(std::uint32_t addr) const;
+  // find address of symbol by name, returns false if not found
+  bool GetAddr(std::string_view name, std::uint32_t &addr) const;
+  // get name of symbol
+  std::string_view GetName(const Symbol &sym) const {
+    return names_.c_str() + sym.name;
+  }
+  // get symbolized string of address (e.g. 'main+0x10'),
+  // returns empty string if not found
+  std::string Symbolize(std::uint32_t addr) const;
+
+  // getters
+  // check if there is no symbol
+  bool empty() const { return syms_.empty(); }
+  // count of symbols
+  std::size_t size() const { return syms_.size(); }
+  // length of the longest symbol name
+  std::size_t max_name_len() const { return max_name_len_; }
+
+ private:
+  // sorted start addresses of symbols
+  std::vector<std::uint32_t> addrs_;
+  // symbols (in the same order of 'addrs_')
+  std::vector<Symbol> syms_;
+  // string pool of names
+  std::string names_;
+  // hashmap of name to address
+  std::unordered_map<std::string_view, std::uint32_t> name_map_;
+  // length of the longest name
+  std::size_t max_name_len_;
+};
+
+#endif  // RISKY32_UTIL_SYMTAB_H_
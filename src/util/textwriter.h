@@ -0,0 +1,67 @@
+#ifndef RISKY32_UTIL_TEXTWRITER_H_
+#define RISKY32_UTIL_TEXTWRITER_H_
+
+#include <string_view>
+#include <cstddef>
+#include <cstdint>
+
+// writer of text to a fixed-size buffer, without any allocation
+// text will be truncated if buffer is too small
+class TextWriter {
+ public:
+  TextWriter(char *buf, std::size_t size)
+      : begin_(buf), cur_(buf), end_(buf + size) {}
+
+  // write a character
+  void Put(char c) {
+    if (cur_ < end_) *cur_++ = c;
+  }
+  // write a string
+  void Put(std::string_view s) {
+    for (const auto &c : s) {
+      if (cur_ >= end_) break;
+      *cur_++ = c;
+    }
+  }
+  // write lowercase hexadecimal number, padded with zeros to 'width'
+  void PutHex(std::uint32_t value, int width = 0) {
+    char digits[8];
+    int len = 0;
+    do {
+      digits[len++] = "0123456789abcdef"[value & 0xf];
+      value >>= 4;
+    } while (value);
+    for (; width > len; --width) Put('0');
+    while (len) Put(digits[--len]);
+  }
+  // write hexadecimal number padded with spaces to 'width'
+  void PutHexRight(std::uint32_t value, int width) {
+    int len = 1;
+    for (auto v = value >> 4; v; v >>= 4) ++len;
+    for (; width > len; --width) Put(' ');
+    PutHex(value);
+  }
+  // write decimal number
+  void PutDec(std::uint32_t value) {
+    char digits[10];
+    int len = 0;
+    do {
+      digits[len++] = '0' + value % 10;
+      value /= 10;
+    } while (value);
+    while (len) Put(digits[--len]);
+  }
+
+  // getters
+  // length of written text
+  std::size_t size() const { return cur_ - begin_; }
+  // check if buffer is full
+  bool full() const { return cur_ >= end_; }
+  // written text
+  std::string_view text() const { return {begin_, size()}; }
+
+ private:
+  char *begin_, *cur_, *end_;
+};
+
+#endif  // RISKY32_UTIL_TEXTWRITER_H_
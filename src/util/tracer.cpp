@@ -0,0 +1,114 @@
+#include "util/tracer.h"
+
+#include <string>
+#include <cassert>
+
+#include <zlib.h>
+
+namespace {
+
+// size & count of chunks in ring buffer
+constexpr std::size_t kChunkSize = 1 << 20;
+constexpr std::size_t kChunkCount = 32;
+// size of compressed output buffer
+constexpr std::size_t kOutBufSize = 1 << 18;
+
+}  // namespace
+
+TraceWriter::TraceWriter()
+    : file_(nullptr), failed_(false), cur_(nullptr), end_(nullptr),
+      last_pc_(-4), last_addr_(0), submitted_(0), written_(0),
+      closing_(false) {}
+
+bool TraceWriter::Open(std::string_view file) {
+  Close();
+  file_ = std::fopen(std::string(file).c_str(), "wb");
+  if (!file_) return false;
+  failed_ = false;
+  // allocate all chunks
+  if (chunks_.empty()) {
+    chunks_.resize(kChunkCount);
+    for (auto &chunk : chunks_) {
+      chunk.data = std::make_unique<std::uint8_t[]>(kChunkSize);
+    }
+  }
+  submitted_ = written_ = 0;
+  closing_ = false;
+  last_pc_ = -4;
+  last_addr_ = 0;
+  // write header to the first chunk
+  cur_ = chunks_[0].data.get();
+  end_ = cur_ + kChunkSize;
+  for (const auto &c : kTraceMagic) *cur_++ = c;
+  for (int i = 0; i < 32; i += 8) *cur_++ = kTraceVersion >> i;
+  // start writer thread
+  writer_ = std::thread([this] { WriterMain(); });
+  return true;
+}
+
+bool TraceWriter::Close() {
+  if (!file_) return !failed_;
+  // submit the last chunk and wait for writer thread
+  NextChunk();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    closing_ = true;
+  }
+  cond_.notify_all();
+  writer_.join();
+  if (std::fclose(file_)) failed_ = true;
+  file_ = nullptr;
+  cur_ = end_ = nullptr;
+  return !failed_;
+}
+
+void TraceWriter::NextChunk() {
+  assert(file_);
+  auto &chunk = chunks_[submitted_ % kChunkCount];
+  chunk.size = cur_ - chunk.data.get();
+  std::unique_lock<std::mutex> lock(mutex_);
+  ++submitted_;
+  cond_.notify_all();
+  // wait until the next chunk has been written
+  cond_.wait(lock, [this] { return submitted_ - written_ < kChunkCount; });
+  cur_ = chunks_[submitted_ % kChunkCount].data.get();
+  end_ = cur_ + kChunkSize;
+}
+
+void TraceWriter::WriterMain() {
+  z_stream zs = {};
+  if (deflateInit2(&zs, Z_BEST_SPEED, Z_DEFLATED, kTraceGzipWindowBits,
+                   8, Z_DEFAULT_STRATEGY) != Z_OK) {
+    failed_ = true;
+  }
+  auto out = std::make_unique<std::uint8_t[]>(kOutBufSize);
+  // compress data and write to file
+  auto compress = [&](const std::uint8_t *data, std::size_t size,
+                      int flush) {
+    zs.next_in = const_cast<std::uint8_t *>(data);
+    zs.avail_in = size;
+    do {
+      zs.next_out = out.get();
+      zs.avail_out = kOutBufSize;
+      if (deflate(&zs, flush) == Z_STREAM_ERROR) failed_ = true;
+      auto len = kOutBufSize - zs.avail_out;
+      if (std::fwrite(out.get(), 1, len, file_) != len) failed_ = true;
+    } while (!zs.avail_out);
+  };
+  for (;;) {
+    // wait for a submitted chunk
+    std::unique_lock<std::mutex> lock(mutex_);
+    cond_.wait(lock, [this] { return written_ < submitted_ || closing_; });
+    if (written_ == submitted_) break;
+    const auto &chunk = chunks_[written_ % kChunkCount];
+    lock.unlock();
+    // compress chunk
+    if (!failed_) compress(chunk.data.get(), chunk.size, Z_NO_FLUSH);
+    lock.lock();
+    ++written_;
+    cond_.notify_all();
+  }
+  // finish compression
+  if (!failed_) compress(nullptr, 0, Z_FINISH);
+  deflateEnd(&zs);
+}
@@ -0,0 +1,153 @@
+#ifndef RISKY32_UTIL_TRACER_H_
+#define RISKY32_UTIL_TRACER_H_
+
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstdio>
+#include <cstdint>
+#include <cstddef>
+
+#include "define/inst.h"
+
+/*
+
+Layout of execution trace file (version 1, gzip compressed):
+
+  header:
+    magic     char[8]     "RISKY32T"
+    version   u32         'kTraceVersion' (little endian)
+
+  records (one per retired instruction):
+    flags     u8          bit 0: PC is not sequential
+                          bit 1: register write-back
+                          bit 2: memory access
+                          bit 3: memory write
+    pc        sleb128     PC minus (last PC + 4), if flags bit 0 set
+    inst      u32         instruction data (little endian)
+    rd        u8          destination register, if flags bit 1 set
+    value     uleb128     value written to 'rd', if flags bit 1 set
+    addr      sleb128     virtual address minus last address,
+                          if flags bit 2 set
+    data      uleb128     data written to memory (zero-extended, width is
+                          given by 'inst'), if flags bit 3 set
+
+PC of the first record is relative to -4. Data read from memory is the
+value written to 'rd'. Flags bit 3 is clear if no write was performed
+(e.g. 'lr.w', or 'sc.w' that failed).
+
+*/
+
+// magic number of execution trace file
+constexpr char kTraceMagic[8] = {'R', 'I', 'S', 'K', 'Y', '3', '2', 'T'};
+// version of execution trace file format
+constexpr std::uint32_t kTraceVersion = 1;
+// size of header of execution trace file
+constexpr std::size_t kTraceHeaderSize =
+    sizeof(kTraceMagic) + sizeof(kTraceVersion);
+// max size of an encoded record
+constexpr std::size_t kTraceMaxRecordSize = 32;
+// window bits of zlib for gzip format
+constexpr int kTraceGzipWindowBits = 15 + 16;
+
+// writer of execution trace
+// records are encoded into chunks of a ring buffer, full chunks are
+// compressed & written to file by a separate writer thread, so that
+// tracing only costs encoding of each record
+class TraceWriter {
+ public:
+  TraceWriter();
+  ~TraceWriter() { Close(); }
+
+  // create trace file and start writer thread, returns false if failed
+  bool Open(std::string_view file);
+  // flush all records and close trace file,
+  // returns false if any error occurred
+  bool Close();
+
+  // append a record of retired instruction
+  // 'rd_value' is the new value of 'rd', 'mem_addr' is the virtual
+  // address of data access, 'store_data' is the data written to memory
+  // if 'is_store' is set
+  void Retire(std::uint32_t pc, std::uint32_t inst_data,
+              std::uint32_t rd_value, std::uint32_t mem_addr,
+              bool is_store, std::uint32_t store_data) {
+    if (static_cast<std::size_t>(end_ - cur_) < kTraceMaxRecordSize) {
+      NextChunk();
+    }
+    auto opcode = inst_data & 0x7f, rd = (inst_data >> 7) & 0x1f;
+    auto is_mem = opcode == kLoad || opcode == kStore || opcode == kAMO;
+    auto has_rd = rd && opcode != kStore && opcode != kBranch;
+    auto is_jump = pc != last_pc_ + 4;
+    *cur_++ = is_jump | (has_rd << 1) | (is_mem << 2) | (is_store << 3);
+    if (is_jump) PutSLEB128(pc - (last_pc_ + 4));
+    last_pc_ = pc;
+    for (int i = 0; i < 32; i += 8) *cur_++ = inst_data >> i;
+    if (has_rd) {
+      *cur_++ = rd;
+      PutULEB128(rd_value);
+    }
+    if (is_mem) {
+      PutSLEB128(mem_addr - last_addr_);
+      last_addr_ = mem_addr;
+    }
+    if (is_store) PutULEB128(store_data);
+  }
+
+ private:
+  // chunk of ring buffer
+  struct Chunk {
+    std::unique_ptr<std::uint8_t[]> data;
+    std::size_t size;
+  };
+
+  // write an unsigned LEB128 number
+  void PutULEB128(std::uint32_t value) {
+    while (value >= 0x80) {
+      *cur_++ = value | 0x80;
+      value >>= 7;
+    }
+    *cur_++ = value;
+  }
+  // write a signed LEB128 number (value is treated as signed)
+  void PutSLEB128(std::uint32_t value) {
+    auto v = static_cast<std::int32_t>(value);
+    for (;;) {
+      std::uint8_t byte = v & 0x7f;
+      v >>= 7;
+      if ((!v && !(byte & 0x40)) || (v == -1 && (byte & 0x40))) {
+        *cur_++ = byte;
+        return;
+      }
+      *cur_++ = byte | 0x80;
+    }
+  }
+
+  // submit current chunk to writer thread, and wait for a free chunk
+  void NextChunk();
+  // main loop of writer thread
+  void WriterMain();
+
+  // output file
+  std::FILE *file_;
+  std::atomic<bool> failed_;
+  // ring buffer of chunks
+  std::vector<Chunk> chunks_;
+  // current position & end of current chunk
+  std::uint8_t *cur_, *end_;
+  // last PC & last memory address
+  std::uint32_t last_pc_, last_addr_;
+  // writer thread
+  std::thread writer_;
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  // count of submitted & written chunks, and closing flag
+  std::size_t submitted_, written_;
+  bool closing_;
+};
+
+#endif  // RISKY32_UTIL_TRACER_H_
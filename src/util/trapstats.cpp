@@ -0,0 +1,110 @@
+#include "util/trapstats.h"
+
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+#include <string>
+#include <sstream>
+
+namespace {
+
+// width of bars in histograms
+constexpr std::uint64_t kBarWidth = 40;
+
+// names of exceptions (indexed by cause)
+constexpr const char *kExcNames[16] = {
+  "instruction address misaligned", "instruction access fault",
+  "illegal instruction", "breakpoint", "load address misaligned",
+  "load access fault", "store/AMO address misaligned",
+  "store/AMO access fault", "environment call from U-mode",
+  "environment call from S-mode", nullptr,
+  "environment call from M-mode", "instruction page fault",
+  "load page fault", nullptr, "store/AMO page fault",
+};
+
+// names of interrupts (indexed by cause)
+constexpr const char *kIntNames[16] = {
+  nullptr, "supervisor software interrupt", nullptr,
+  "machine software interrupt", nullptr, "supervisor timer interrupt",
+  nullptr, "machine timer interrupt", nullptr,
+  "supervisor external interrupt", nullptr,
+  "machine external interrupt",
+};
+
+}  // namespace
+
+void LogHistogram::Print(std::ostream &os, std::string_view indent) const {
+  os << indent << "count " << count_ << ", mean " << std::fixed
+     << std::setprecision(1)
+     << (count_ ? static_cast<double>(sum_) / count_ : 0.0) << ", max "
+     << max_ << std::endl;
+  auto peak = *std::max_element(buckets_.begin(), buckets_.end());
+  for (std::size_t i = 0; i < buckets_.size(); ++i) {
+    if (!buckets_[i]) continue;
+    // print range of bucket
+    std::ostringstream range;
+    if (i <= 1) {
+      range << i;
+    }
+    else {
+      auto lo = 1ULL << (i - 1);
+      range << lo << '-' << lo * 2 - 1;
+    }
+    os << indent << std::setw(16) << range.str() << std::setw(12)
+       << buckets_[i] << "  "
+       << std::string((buckets_[i] * kBarWidth + peak - 1) / peak, '#')
+       << std::endl;
+  }
+}
+
+void TrapStats::Trap(std::uint32_t cause) {
+  auto index = GetIndex(cause);
+  auto &stats = stats_[index];
+  ++stats.count;
+  if (cause >> 31) {
+    auto bit = cause & (kCauseCount - 1);
+    stats.latency.Add(now_ - pending_since_[bit]);
+    // the next interrupt is measured from now if the bit stays high
+    pending_since_[bit] = now_;
+  }
+  // drop the outermost handler if nested too deep
+  if (frames_.size() == kMaxDepth) frames_.erase(frames_.begin());
+  frames_.push_back({index, now_});
+}
+
+void TrapStats::ReturnFromTrap() {
+  // 'xret' may be used without any trap (e.g. entering U-mode)
+  if (frames_.empty()) return;
+  const auto &frame = frames_.back();
+  stats_[frame.index].handler.Add(now_ - frame.entry);
+  frames_.pop_back();
+}
+
+bool TrapStats::WriteReport(std::string_view file) const {
+  std::ofstream ofs{std::string(file)};
+  if (!ofs) return false;
+  std::uint64_t total = 0;
+  for (const auto &stats : stats_) total += stats.count;
+  ofs << "trap statistics (in retired instructions)" << std::endl;
+  ofs << "  traps: " << total << ", handlers not returned: "
+      << frames_.size() << std::endl;
+  for (std::uint32_t i = 0; i < stats_.size(); ++i) {
+    const auto &stats = stats_[i];
+    if (!stats.count) continue;
+    // print cause
+    auto is_int = i >= kCauseCount;
+    auto cause = i & (kCauseCount - 1);
+    auto name = is_int ? kIntNames[cause] : kExcNames[cause];
+    ofs << std::endl << (is_int ? "interrupt " : "exception ") << cause;
+    if (name) ofs << " (" << name << ')';
+    ofs << ": " << stats.count << std::endl;
+    // print histograms
+    ofs << "  handler instructions (trap entry to xRET):" << std::endl;
+    stats.handler.Print(ofs, "    ");
+    if (is_int) {
+      ofs << "  latency (pending to taken):" << std::endl;
+      stats.latency.Print(ofs, "    ");
+    }
+  }
+  return static_cast<bool>(ofs);
+}
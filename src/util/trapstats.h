@@ -0,0 +1,111 @@
+#ifndef RISKY32_UTIL_TRAPSTATS_H_
+#define RISKY32_UTIL_TRAPSTATS_H_
+
+#include <ostream>
+#include <string_view>
+#include <vector>
+#include <array>
+#include <cstdint>
+#include <cstddef>
+
+#include "define/inst.h"
+
+// histogram with log-scaled buckets
+// bucket 0 counts value 0, bucket 'i' counts values in [2^(i-1), 2^i)
+class LogHistogram {
+ public:
+  LogHistogram() : buckets_({}), count_(0), sum_(0), max_(0) {}
+
+  // add a value to histogram
+  void Add(std::uint64_t value) {
+    std::size_t bucket = 0;
+    while (bucket < 64 && (value >> bucket)) ++bucket;
+    ++buckets_[bucket];
+    ++count_;
+    sum_ += value;
+    if (value > max_) max_ = value;
+  }
+
+  // print histogram, each line is prefixed by 'indent'
+  void Print(std::ostream &os, std::string_view indent) const;
+
+  // getters
+  std::uint64_t count() const { return count_; }
+
+ private:
+  std::array<std::uint64_t, 65> buckets_;
+  std::uint64_t count_, sum_, max_;
+};
+
+// statistics of traps, measured in retired instructions:
+//   count of each cause
+//   instructions spent in handler, from trap entry to the matching
+//   'mret'/'sret' (including nested handlers)
+//   interrupt latency, from the pending bit in 'mip' going high to the
+//   interrupt being taken
+class TrapStats {
+ public:
+  TrapStats() : now_(0), last_mip_(0), pending_since_({}), stats_() {}
+
+  // update pending interrupts, called every cycle before 'Retire'/'Trap'
+  void Update(std::uint32_t mip) {
+    if (auto rising = mip & ~last_mip_) {
+      for (std::uint32_t i = 0; i < kCauseCount; ++i) {
+        if (rising & (1u << i)) pending_since_[i] = now_;
+      }
+    }
+    last_mip_ = mip;
+  }
+  // handle a retired instruction
+  void Retire(std::uint32_t inst_data) {
+    ++now_;
+    if (inst_data == kInstMRET || inst_data == kInstSRET) ReturnFromTrap();
+  }
+  // handle a trap with cause ('mcause')
+  void Trap(std::uint32_t cause);
+
+  // write report to file, returns false if failed
+  bool WriteReport(std::string_view file) const;
+
+ private:
+  // count of causes of exceptions (or interrupts)
+  static constexpr std::uint32_t kCauseCount = 16;
+  // max depth of nested traps
+  static constexpr std::size_t kMaxDepth = 64;
+  // encoding of 'mret' & 'sret'
+  static constexpr std::uint32_t kInstMRET = (kMRET << 20) | kSystem;
+  static constexpr std::uint32_t kInstSRET = (kSRET << 20) | kSystem;
+
+  // statistics of a cause
+  struct CauseStats {
+    std::uint64_t count;
+    LogHistogram handler, latency;
+  };
+
+  // active trap handler
+  struct Frame {
+    std::uint32_t index;
+    std::uint64_t entry;
+  };
+
+  // get index of cause in 'stats_'
+  static std::uint32_t GetIndex(std::uint32_t cause) {
+    return (cause & (kCauseCount - 1)) | ((cause >> 31) ? kCauseCount : 0);
+  }
+
+  // handle the end of the innermost handler
+  void ReturnFromTrap();
+
+  // count of retired instructions
+  std::uint64_t now_;
+  // the last value of 'mip'
+  std::uint32_t last_mip_;
+  // time when each interrupt became pending
+  std::array<std::uint64_t, kCauseCount> pending_since_;
+  // statistics of exceptions & interrupts
+  std::array<CauseStats, kCauseCount * 2> stats_;
+  // stack of active handlers
+  std::vector<Frame> frames_;
+};
+
+#endif  // RISKY32_UTIL_TRAPSTATS_H_
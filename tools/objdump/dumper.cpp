@@ -0,0 +1,90 @@
+#include "objdump/dumper.h"
+
+#include "debugger/disasm.h"
+
+Dumper::Dumper(const SymbolTable *symbols, std::size_t max_count)
+    : symbols_(symbols), len_(0) {
+  // each instruction takes at most one label line and one normal line,
+  // both of which may contain a symbol name
+  auto name_len = symbols_ ? symbols_->max_name_len() : 0;
+  buf_.resize(max_count * 2 * (kMaxLineLen + name_len));
+}
+
+void Dumper::DumpImage(const std::uint32_t *insts, std::size_t count,
+                       std::uint32_t addr) {
+  // retry with a larger buffer if the text was truncated
+  for (;;) {
+    TextWriter w(buf_.data(), buf_.size());
+    WriteImage(w, insts, count, addr);
+    if (Commit(w)) break;
+  }
+}
+
+void Dumper::DumpTrace(const TraceRecord *recs, std::size_t count) {
+  for (;;) {
+    TextWriter w(buf_.data(), buf_.size());
+    WriteTrace(w, recs, count);
+    if (Commit(w)) break;
+  }
+}
+
+bool Dumper::Commit(const TextWriter &w) {
+  if (!w.full()) {
+    len_ = w.size();
+    return true;
+  }
+  buf_.resize(buf_.size() * 2 + kMaxLineLen);
+  return false;
+}
+
+void Dumper::WriteImage(TextWriter &w, const std::uint32_t *insts,
+                        std::size_t count, std::uint32_t addr) {
+  for (std::size_t i = 0; i < count; ++i, addr += 4) {
+    // print label if there is a symbol starting at current address
+    if (symbols_) {
+      auto sym = symbols_->Find(addr);
+      if (sym && sym->addr == addr) {
+        w.Put('\n');
+        w.PutHex(addr, 8);
+        w.Put(" <");
+        w.Put(symbols_->GetName(*sym));
+        w.Put(">:\n");
+      }
+    }
+    // print instruction
+    w.PutHexRight(addr, 8);
+    w.Put(":\t");
+    PrintInst(w, insts[i], addr);
+  }
+}
+
+void Dumper::WriteTrace(TextWriter &w, const TraceRecord *recs,
+                        std::size_t count) {
+  for (std::size_t i = 0; i < count; ++i) {
+    PrintAddr(w, recs[i].pc);
+    w.Put(":\t");
+    PrintInst(w, recs[i].inst, recs[i].pc);
+  }
+}
+
+void Dumper::PrintAddr(TextWriter &w, std::uint32_t addr) {
+  w.PutHexRight(addr, 8);
+  if (!symbols_) return;
+  if (auto sym = symbols_->Find(addr)) {
+    w.Put(" <");
+    w.Put(symbols_->GetName(*sym));
+    if (addr != sym->addr) {
+      w.Put("+0x");
+      w.PutHex(addr - sym->addr);
+    }
+    w.Put('>');
+  }
+}
+
+void Dumper::PrintInst(TextWriter &w, std::uint32_t inst,
+                       std::uint32_t addr) {
+  w.PutHex(inst, 8);
+  w.Put('\t');
+  DisassembleTo(w, inst, addr, symbols_);
+  w.Put('\n');
+}
@@ -0,0 +1,74 @@
+#ifndef RISKY32_OBJDUMP_DUMPER_H_
+#define RISKY32_OBJDUMP_DUMPER_H_
+
+#include <string_view>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include "util/symtab.h"
+#include "util/textwriter.h"
+
+/*
+
+Layout of raw instruction trace file:
+
+  records (in order of execution):
+    pc        u32         address of instruction (little endian)
+    inst      u32         instruction data (little endian)
+
+Execution traces written by '--trace' of emulator (gzip compressed,
+see 'util/tracer.h') are also accepted, and decoded into records.
+
+*/
+
+// record of instruction trace
+struct TraceRecord {
+  std::uint32_t pc;
+  std::uint32_t inst;
+};
+
+// disassembler of a chunk of instructions
+// output buffer is allocated when constructing, so dumping a chunk
+// usually does not allocate memory (the buffer only grows if the text
+// does not fit), and dumpers of different chunks can run in different
+// threads
+class Dumper {
+ public:
+  // 'max_count' is the max count of instructions in a chunk
+  Dumper(const SymbolTable *symbols, std::size_t max_count);
+
+  // dump instructions of image, starting at address 'addr'
+  void DumpImage(const std::uint32_t *insts, std::size_t count,
+                 std::uint32_t addr);
+  // dump records of trace
+  void DumpTrace(const TraceRecord *recs, std::size_t count);
+
+  // getters
+  // text of the last dumped chunk
+  std::string_view text() const { return {buf_.data(), len_}; }
+
+ private:
+  // max length of line, excluding length of symbol names
+  static constexpr std::size_t kMaxLineLen = 128;
+
+  // write instructions of image to 'w'
+  void WriteImage(TextWriter &w, const std::uint32_t *insts,
+                  std::size_t count, std::uint32_t addr);
+  // write records of trace to 'w'
+  void WriteTrace(TextWriter &w, const TraceRecord *recs,
+                  std::size_t count);
+  // record length of text in 'w' if it was not truncated, otherwise
+  // grow the buffer and return false
+  bool Commit(const TextWriter &w);
+  // print address & symbolized address (if possible)
+  void PrintAddr(TextWriter &w, std::uint32_t addr);
+  // print instruction data & disassembly, and then end the line
+  void PrintInst(TextWriter &w, std::uint32_t inst, std::uint32_t addr);
+
+  const SymbolTable *symbols_;
+  std::vector<char> buf_;
+  std::size_t len_;
+};
+
+#endif  // RISKY32_OBJDUMP_DUMPER_H_
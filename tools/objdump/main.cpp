@@ -0,0 +1,227 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <algorithm>
+#include <cstdio>
+#include <cstddef>
+#include <cstdint>
+
+#include "objdump/dumper.h"
+#include "define/mmio.h"
+#include "util/argparse.h"
+#include "util/symtab.h"
+#include "util/commitlog.h"
+#include "version.h"
+
+using namespace std;
+
+namespace {
+
+// max count of instructions in a chunk (dumped by one thread)
+constexpr size_t kChunkSize = 1 << 16;
+
+// print version info to stdout
+void PrintVersion() {
+  cout << APP_NAME << "-objdump version " << APP_VERSION << endl;
+  cout << "Offline disassembler of Risky32." << endl;
+  cout << endl;
+  cout << "Copyright (C) 2010-2019 MaxXing, MaxXSoft. License GPLv3.";
+  cout << endl;
+}
+
+// dump all chunks of the current batch in parallel, and then write
+// text of all chunks to output in order
+// 'dump' is called with index of dumper, offset and count of chunk
+template <typename Dump>
+bool DumpBatch(vector<Dumper> &dumpers, size_t count, FILE *out,
+               Dump dump) {
+  auto chunk_count = (count + kChunkSize - 1) / kChunkSize;
+  vector<thread> workers;
+  for (size_t i = 1; i < chunk_count; ++i) {
+    auto ofs = i * kChunkSize;
+    workers.emplace_back(dump, i, ofs, min(kChunkSize, count - ofs));
+  }
+  dump(0, 0, min(kChunkSize, count));
+  for (auto &&worker : workers) worker.join();
+  // write to output
+  for (size_t i = 0; i < chunk_count; ++i) {
+    auto text = dumpers[i].text();
+    if (fwrite(text.data(), 1, text.size(), out) != text.size()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// dump raw binary image
+bool DumpImage(vector<Dumper> &dumpers, FILE *in, FILE *out,
+               uint32_t base) {
+  vector<uint32_t> insts(dumpers.size() * kChunkSize);
+  for (auto addr = base;;) {
+    // read a batch, incomplete instruction at the end is padded
+    fill(insts.begin(), insts.end(), 0);
+    auto len = fread(insts.data(), 1, insts.size() * 4, in);
+    if (!len) break;
+    auto count = (len + 3) / 4;
+    auto ret = DumpBatch(dumpers, count, out,
+                         [&](size_t id, size_t ofs, size_t n) {
+                           dumpers[id].DumpImage(insts.data() + ofs, n,
+                                                 addr + ofs * 4);
+                         });
+    if (!ret) return false;
+    addr += count * 4;
+  }
+  return !ferror(in);
+}
+
+// dump instruction trace
+bool DumpTrace(vector<Dumper> &dumpers, FILE *in, FILE *out) {
+  vector<TraceRecord> recs(dumpers.size() * kChunkSize);
+  for (;;) {
+    // read a batch, incomplete record at the end is ignored
+    auto count = fread(recs.data(), sizeof(TraceRecord), recs.size(), in);
+    if (!count) break;
+    auto ret = DumpBatch(dumpers, count, out,
+                         [&](size_t id, size_t ofs, size_t n) {
+                           dumpers[id].DumpTrace(recs.data() + ofs, n);
+                         });
+    if (!ret) return false;
+  }
+  return !ferror(in);
+}
+
+// dump execution trace of emulator
+bool DumpExecTrace(vector<Dumper> &dumpers, CommitLogReader &reader,
+                   FILE *out) {
+  vector<TraceRecord> recs(dumpers.size() * kChunkSize);
+  for (;;) {
+    // decode a batch
+    size_t count = 0;
+    CommitRecord rec;
+    while (count < recs.size() && reader.Next(rec)) {
+      recs[count++] = {rec.pc, rec.inst};
+    }
+    if (!count) break;
+    auto ret = DumpBatch(dumpers, count, out,
+                         [&](size_t id, size_t ofs, size_t n) {
+                           dumpers[id].DumpTrace(recs.data() + ofs, n);
+                         });
+    if (!ret) return false;
+  }
+  return !reader.failed();
+}
+
+// check if file is compressed by gzip
+bool IsGzipFile(FILE *in) {
+  auto b0 = fgetc(in), b1 = fgetc(in);
+  rewind(in);
+  return b0 == 0x1f && b1 == 0x8b;
+}
+
+}  // namespace
+
+int main(int argc, const char *argv[]) {
+  // set up argument parser
+  ArgParser argp;
+  argp.AddArgument<string>("input", "input binary image or trace file");
+  argp.AddOption<bool>("help", "h", "show this message", false);
+  argp.AddOption<bool>("version", "v", "show version info", false);
+  argp.AddOption<bool>("trace", "t",
+                       "input is an instruction trace (PC & data pairs, "
+                       "or '--trace' output of emulator)",
+                       false);
+  argp.AddOption<string>("base", "b",
+                         "set base address of image (default to ROM)",
+                         "");
+  argp.AddOption<string>("symbols", "sym",
+                         "load symbols from ELF file of guest program", "");
+  argp.AddOption<int>("jobs", "j",
+                      "set count of threads (default to CPU count)", 0);
+  argp.AddOption<string>("output", "o", "write output to file", "");
+
+  // parse argument
+  auto ret = argp.Parse(argc, argv);
+
+  // check if need to exit program
+  if (argp.GetValue<bool>("help")) {
+    argp.PrintHelp();
+    return 0;
+  }
+  else if (argp.GetValue<bool>("version")) {
+    PrintVersion();
+    return 0;
+  }
+  else if (!ret) {
+    cerr << "invalid input, run '";
+    cerr << argp.program_name() << " -h' for help" << endl;
+    return 1;
+  }
+
+  // get input
+  auto input = argp.GetValue<string>("input");
+  auto base_str = argp.GetValue<string>("base");
+  auto symbol_file = argp.GetValue<string>("symbols");
+  auto output = argp.GetValue<string>("output");
+  auto jobs = argp.GetValue<int>("jobs");
+  uint32_t base = kMMIOAddrROM;
+  if (!base_str.empty()) {
+    size_t pos = 0;
+    try {
+      base = stoul(base_str, &pos, 0);
+    }
+    catch (...) {
+      pos = 0;
+    }
+    if (pos != base_str.size() || (base & 0b11)) {
+      cerr << "error: invalid base address '" << base_str << "'" << endl;
+      return 1;
+    }
+  }
+  if (jobs <= 0) jobs = max(thread::hardware_concurrency(), 1u);
+
+  // load symbols
+  SymbolTable symbols;
+  if (!symbol_file.empty() && !symbols.LoadELF(symbol_file)) {
+    cerr << "error: failed to load symbols from '" << symbol_file << "'"
+         << endl;
+    return 1;
+  }
+
+  // open files
+  auto in = fopen(input.c_str(), "rb");
+  if (!in) {
+    cerr << "error: failed to open file '" << input << "'" << endl;
+    return 1;
+  }
+  auto out = output.empty() ? stdout : fopen(output.c_str(), "wb");
+  if (!out) {
+    cerr << "error: failed to create file '" << output << "'" << endl;
+    fclose(in);
+    return 1;
+  }
+
+  // initialize dumpers, all buffers are allocated here
+  vector<Dumper> dumpers;
+  auto syms = symbols.empty() ? nullptr : &symbols;
+  for (int i = 0; i < jobs; ++i) dumpers.emplace_back(syms, kChunkSize);
+
+  // dump
+  if (!argp.GetValue<bool>("trace")) {
+    ret = DumpImage(dumpers, in, out, base);
+  }
+  else if (IsGzipFile(in)) {
+    CommitLogReader reader;
+    ret = reader.Open(input) && DumpExecTrace(dumpers, reader, out);
+  }
+  else {
+    ret = DumpTrace(dumpers, in, out);
+  }
+  fclose(in);
+  if (out != stdout) ret = !fclose(out) && ret;
+  if (!ret) {
+    cerr << "error: failed to dump '" << input << "'" << endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,137 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <cstdint>
+
+#include <signal.h>
+#include <sys/types.h>
+
+#include "util/argparse.h"
+#include "util/perfshm.h"
+#include "version.h"
+
+using namespace std;
+
+namespace {
+
+// print version info to stdout
+void PrintVersion() {
+  cout << APP_NAME << "-top version " << APP_VERSION << endl;
+  cout << "Live performance monitor of Risky32." << endl;
+  cout << endl;
+  cout << "Copyright (C) 2010-2019 MaxXing, MaxXSoft. License GPLv3.";
+  cout << endl;
+}
+
+// print a line of counter, with its rate since the last update
+// rate is not printed if counter has gone backwards
+void PrintCounter(const char *name, uint64_t value, uint64_t last,
+                  double seconds) {
+  cout << "  " << setw(14) << left << name << right << setw(16) << value;
+  if (seconds > 0 && value >= last) {
+    cout << setw(14) << fixed << setprecision(1)
+         << (value - last) / seconds << "/s";
+  }
+  cout << endl;
+}
+
+// print all counters
+void PrintCounters(uint32_t pid, const PerfCounters &cur,
+                   const PerfCounters &last, bool batch) {
+  if (!batch) cout << "\x1b[H\x1b[2J";
+  // rates are not printed across restarts of emulation
+  auto seconds = cur.restarts == last.restarts
+                     ? (cur.update_time - last.update_time) / 1e9
+                     : 0.0;
+  auto uptime = (cur.update_time - cur.start_time) / 1e9;
+  cout << "risky32 (pid " << pid << "), "
+       << (cur.stopped ? "stopped" : "running") << ", " << fixed
+       << setprecision(1) << uptime << " s";
+  if (cur.restarts) cout << ", " << cur.restarts << " restarts";
+  cout << endl;
+  cout << "  " << setw(14) << left << "MIPS" << right << setw(16)
+       << setprecision(2) << cur.mips;
+  // average is unknown after restarts, since 'retired' is not cumulative
+  if (uptime > 0 && !cur.restarts) {
+    cout << setw(14) << cur.retired / uptime / 1e6 << " avg";
+  }
+  cout << endl;
+  PrintCounter("retired", cur.retired, last.retired, seconds);
+  PrintCounter("exceptions", cur.exceptions, last.exceptions, seconds);
+  PrintCounter("interrupts", cur.interrupts, last.interrupts, seconds);
+  PrintCounter("page walks", cur.page_walks, last.page_walks, seconds);
+  PrintCounter("console in", cur.io_input, last.io_input, seconds);
+  PrintCounter("console out", cur.io_output, last.io_output, seconds);
+  if (batch) cout << endl;
+}
+
+}  // namespace
+
+int main(int argc, const char *argv[]) {
+  // set up argument parser
+  ArgParser argp;
+  argp.AddArgument<string>("name", "name of shared memory segment "
+                                   "('--perf-shm' of emulator)");
+  argp.AddOption<bool>("help", "h", "show this message", false);
+  argp.AddOption<bool>("version", "v", "show version info", false);
+  argp.AddOption<int>("interval", "i",
+                      "set refresh interval in milliseconds "
+                      "(default to 1000)",
+                      1000);
+  argp.AddOption<bool>("batch", "b",
+                       "append updates to output instead of redrawing",
+                       false);
+
+  // parse argument
+  auto ret = argp.Parse(argc, argv);
+
+  // check if need to exit program
+  if (argp.GetValue<bool>("help")) {
+    argp.PrintHelp();
+    return 0;
+  }
+  else if (argp.GetValue<bool>("version")) {
+    PrintVersion();
+    return 0;
+  }
+  else if (!ret) {
+    cerr << "invalid input, run '";
+    cerr << argp.program_name() << " -h' for help" << endl;
+    return 1;
+  }
+
+  // get input
+  auto name = argp.GetValue<string>("name");
+  auto interval = argp.GetValue<int>("interval");
+  auto batch = argp.GetValue<bool>("batch");
+  if (interval <= 0) {
+    cerr << "error: invalid interval (" << interval << ')' << endl;
+    return 1;
+  }
+
+  // open segment
+  PerfShmReader reader;
+  if (!reader.Open(name)) {
+    cerr << "error: failed to open shared memory '" << name << "'"
+         << endl;
+    return 1;
+  }
+
+  // print counters until emulator stops
+  PerfCounters cur, last;
+  reader.Read(last);
+  for (;;) {
+    this_thread::sleep_for(chrono::milliseconds(interval));
+    reader.Read(cur);
+    PrintCounters(reader.pid(), cur, last, batch);
+    if (cur.stopped) break;
+    if (kill(reader.pid(), 0) < 0) {
+      cerr << "emulator has exited unexpectedly" << endl;
+      return 1;
+    }
+    last = cur;
+  }
+  return 0;
+}